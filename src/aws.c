@@ -6,21 +6,23 @@
 
 #include <openssl/pem.h>
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <curl/curl.h>
+#include <pthread.h>
 
-#include "apr_base64.h"
 #include "turbo.h"
 
-static struct	CURL_DATA
+struct	CURL_DATA
 {
 	apr_pool_t *		pool ;
 	apr_array_header_t *	a ;
-} curl_data ;
+} ;
 
-static size_t	curl_read_response (void * ptr, size_t size, size_t nmemb, struct CURL_DATA * data)
+static size_t	curl_append_response (void * ptr, size_t size, size_t nmemb, void * data)
 {
-	APR_ARRAY_PUSH(data->a, const char *) = apr_pstrdup(data->pool, ptr) ;
-	return	size * nmemb;
+	struct CURL_DATA *	response = (struct CURL_DATA *)data ;
+	APR_ARRAY_PUSH(response->a, const char *) = apr_pstrmemdup(response->pool, ptr, size * nmemb) ;
+	return	size * nmemb ;
 }
 
 struct	PUT_DATA
@@ -59,24 +61,112 @@ const char *	tb_aws_signature (apr_pool_t * pool, const char * key, const char *
 	char		signature[64] ;
 
 	result = (unsigned char *)tb_hmac_hash(pool, key, key_len, data, data_len, sha1, 1) ;
-	if (result && apr_base64_encode(signature, (const char *)result, result_len) > 0)
+	if (result)
+	{
+		tb_base64_encode(signature, result, result_len) ;
 		return	apr_pstrdup(pool, signature) ;
+	}
 
 	return	NULL ;
 }
 
-static	const void *	generate_hmac_sha256 (apr_pool_t * pool, const void * key, int key_len, const void * str, int str_len, int binary)
-{
-	return	tb_hmac_hash(pool, key, key_len, str, str_len, 0, binary) ;
-}
-
 static	char	aws_access_key [64] ;
 static	char 	aws_secret_key [128] ;
 static	char	ses_email_sender [64] ;
 static	char	s3_bucket [128] ;
+static	unsigned int	aws_key_generation ;	/* tb_aws_init 호출할 때마다 증가. signing key 캐시 무효화 */
+
+/* curl handle 재사용. thread 별 CURLSH 로 DNS cache, TLS session, connection cache 를 공유하므로 같은 thread 의 다음 요청은
+   curl multi 로 보내더라도 keep-alive 연결을 그대로 사용함. connection cache 는 여러 thread 가 동시에 쓰면 안전하지 않으므로
+   process 전체가 아닌 thread 별로 둠. 반납한 easy handle 은 AWS_CURL_POOL_MAX 개까지 보관 */
+#define	AWS_CURL_POOL_MAX	16
+
+static	pthread_once_t		aws_curl_once = PTHREAD_ONCE_INIT ;
+static	pthread_mutex_t		aws_curl_lock = PTHREAD_MUTEX_INITIALIZER ;
+static	pthread_key_t		aws_curl_share_key ;
+static	int			aws_curl_initialized ;
+static	CURL *			aws_curl_pool [AWS_CURL_POOL_MAX] ;
+static	int			aws_curl_pool_n ;
+
+/* thread 종료시 thread 의 CURLSH 정리 */
+static	void	aws_curl_share_free (void * share)
+{
+	curl_share_cleanup(share) ;
+}
+
+static	void	aws_curl_init (void)
+{
+	curl_global_init(CURL_GLOBAL_DEFAULT) ;
+	pthread_key_create(&aws_curl_share_key, aws_curl_share_free) ;
+	aws_curl_initialized = 1 ;
+}
+
+/* 현재 thread 의 CURLSH. 처음 호출할 때 생성. 한 thread 에서만 사용하므로 lock callback 은 필요없음 */
+static	CURLSH *	aws_curl_share (void)
+{
+	CURLSH *	share = pthread_getspecific(aws_curl_share_key) ;
+	if (share)
+		return	share ;
+
+	share = curl_share_init() ;
+	if (! share)
+		return	NULL ;
+
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) ;
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION) ;
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT) ;
+	pthread_setspecific(aws_curl_share_key, share) ;
+
+	return	share ;
+}
+
+/* pool 에서 easy handle 가져오기. 없으면 새로 만듦. 사용 후 aws_curl_release 로 반납 */
+static	CURL *	aws_curl_acquire (void)
+{
+	CURL *	curl = NULL ;
+
+	pthread_once(&aws_curl_once, aws_curl_init) ;
+
+	pthread_mutex_lock(&aws_curl_lock) ;
+	if (aws_curl_pool_n > 0)
+		curl = aws_curl_pool[--aws_curl_pool_n] ;
+	pthread_mutex_unlock(&aws_curl_lock) ;
+
+	if (!curl && !(curl = curl_easy_init()))
+		return	NULL ;
+
+	CURLSH *	share = aws_curl_share() ;
+	if (share)
+		curl_easy_setopt(curl, CURLOPT_SHARE, share) ;
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L) ;
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L) ;
+
+	return	curl ;
+}
+
+/* thread 의 CURLSH 에서 떼고 옵션만 초기화해서 pool 에 반납. 연결은 CURLSH 에 남음. pool 이 차 있으면 정리 */
+static	void	aws_curl_release (CURL * curl)
+{
+	if (! curl)
+		return ;
+
+	curl_easy_setopt(curl, CURLOPT_SHARE, NULL) ;
+	curl_easy_reset(curl) ;
+
+	pthread_mutex_lock(&aws_curl_lock) ;
+	if (aws_curl_pool_n < AWS_CURL_POOL_MAX)
+	{
+		aws_curl_pool[aws_curl_pool_n++] = curl ;
+		curl = NULL ;
+	}
+	pthread_mutex_unlock(&aws_curl_lock) ;
+
+	if (curl)
+		curl_easy_cleanup(curl) ;
+}
 
 /** @fn void	tb_aws_init (const char * access_key, const char * secret_key)
-    @brief	AWS 초기화 : access key, secret key 등록
+    @brief	AWS 초기화 : access key, secret key 등록하고 curl 초기화. child init 에서 호출
     @param	access_key	AWS access key
     @param	secret_key	AWS secret key
 */
@@ -84,6 +174,9 @@ void	tb_aws_init (const char * access_key, const char * secret_key)
 {
 	tb_strncopy(aws_access_key, access_key, _N(aws_access_key)) ;
 	tb_strncopy(aws_secret_key, secret_key, _N(aws_secret_key)) ;
+	aws_key_generation++ ;
+
+	pthread_once(&aws_curl_once, aws_curl_init) ;
 }
 
 /** @fn void	tb_ses_init (const char * email_sender)
@@ -136,8 +229,7 @@ int	tb_ses_send (request_rec * r, const char * email, const char * subject, cons
 	CURL *		curl ;
 	CURLcode	res ;
 
-	curl_global_init(CURL_GLOBAL_DEFAULT) ;
-	curl = curl_easy_init() ;
+	curl = aws_curl_acquire() ;
 	if (! curl)
 		return	FAIL ;
 
@@ -164,24 +256,23 @@ int	tb_ses_send (request_rec * r, const char * email, const char * subject, cons
 	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10) ;
 
 	/* response 데이터 구조 초기화 */
-	curl_data.pool = r->pool ;
-	curl_data.a = apr_array_make(r->pool, 4, sizeof(char *)) ;
+	struct CURL_DATA	body = { .pool = r->pool, .a = apr_array_make(r->pool, 4, sizeof(char *)) } ;
 
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_read_response);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &curl_data);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_append_response) ;
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body) ;
 
 	res = curl_easy_perform(curl) ;
+
+	curl_slist_free_all(header) ;
+	aws_curl_release(curl) ;
+
 	if (res != CURLE_OK)
 	{
 		TB_LOG_ERROR(r, "%s: curl_easy_perform URL: [%s] failed: %s: post: [%s]", __FUNCTION__, url, curl_easy_strerror(res), post_data) ;
 		return	FAIL ;
 	}
 
-	curl_slist_free_all(header) ;
-	curl_easy_cleanup(curl) ;
-	curl_global_cleanup() ;
-
-	const char *	response = apr_array_pstrcat(r->pool, curl_data.a, 0) ;
+	const char *	response = apr_array_pstrcat(r->pool, body.a, 0) ;
 	if (strncmp(response, "<SendEmailResponse", 18))
 	{
 		TB_LOG_ERROR(r, "%s: send email to [%s] response is not succeeded: [%s]", __FUNCTION__, email, response) ;
@@ -200,19 +291,10 @@ void	tb_s3_init (const char * bucket)
 	tb_strncopy(s3_bucket, bucket, _N(s3_bucket)) ;
 }
 
-/** @fn int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t data_n, const char * content_type, int public_read)
-    @brief	AWS S3로 파일 업로드
-    @param	r		request_rec. 메모리 할당, 에러 로깅
-    @param	path		파일명 포함한 경로
-    @param	data		파일 데이터
-    @param	data_n		데이터 사이즈
-    @param	content_type	데이터 Content-Type
-    @param	public_read	1이면 public 권한으로 업로드, 1이 아니면 private 권한으로 업로드
-    @return	성공시 SUCCESS, 실패시 FAIL
-*/
-int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t data_n, const char * content_type, int public_read)
+/* S3 PUT. md5 가 NULL 이 아니면 Content-MD5 header 를 보내서 S3 에서 무결성 확인. data_n 이 0 이면 빈 object 를 만듦 */
+static	int	s3_put_object (request_rec * r, const char * path, const char * data, size_t data_n, const char * content_type, int public_read, const unsigned char * md5)
 {
-	if (!path || data_n <= 0 || !*aws_access_key || !*aws_secret_key)
+	if (!path || !data || !*aws_access_key || !*aws_secret_key)
 		return	FAIL ;
 
 	time_t		now = time(NULL) ;
@@ -221,8 +303,12 @@ int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t
 
 	const char *	date = tb_date_header_value(r->pool, now_tm) ;
 
+	char		content_md5 [32] = "" ;
+	if (md5)
+		tb_base64_encode(content_md5, md5, 16) ;
+
 	/* 참고: http://docs.aws.amazon.com/AmazonS3/latest/dev/RESTAuthentication.html#RESTAuthenticationExamples */
-	const char *	string_to_sign = apr_psprintf(r->pool, "PUT\n\n%s\n%s\n%s/%s/%s", content_type, date, public_read ? "x-amz-acl:public-read\n" : "", s3_bucket, path) ;
+	const char *	string_to_sign = apr_psprintf(r->pool, "PUT\n%s\n%s\n%s\n%s/%s/%s", content_md5, content_type, date, public_read ? "x-amz-acl:public-read\n" : "", s3_bucket, path) ;
 	const char *	signature = tb_aws_signature(r->pool, aws_secret_key, string_to_sign, 1) ;
 	if (! signature)
 		return	FAIL ;
@@ -230,13 +316,9 @@ int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t
 	CURL *		curl ;
 	CURLcode	res ;
 
-	curl_global_init(CURL_GLOBAL_DEFAULT) ;
-	curl = curl_easy_init() ;
+	curl = aws_curl_acquire() ;
 	if (! curl)
-	{
-		curl_global_cleanup() ;
 		return	FAIL ;
-	}
 
 	/* Header 추가 */
 	struct curl_slist *	header = NULL ;
@@ -244,7 +326,10 @@ int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t
 	header = curl_slist_append(header, apr_psprintf(r->pool, "Host: %s", host)) ;
 	if (public_read) header = curl_slist_append(header, "x-amz-acl: public-read") ;
 	header = curl_slist_append(header, apr_psprintf(r->pool, "Content-Type: %s", content_type)) ;
-	header = curl_slist_append(header, apr_psprintf(r->pool, "Content-Length: %ld", data_n)) ;
+	if (md5) header = curl_slist_append(header, apr_psprintf(r->pool, "Content-MD5: %s", content_md5)) ;
+	char		length [TB_NUMBER_BUF_SIZE] ;
+	tb_utoa(length, data_n) ;
+	header = curl_slist_append(header, apr_pstrcat(r->pool, "Content-Length: ", length, NULL)) ;
 	header = curl_slist_append(header, apr_psprintf(r->pool, "Date: %s", date)) ;
 	header = curl_slist_append(header, apr_psprintf(r->pool, "Authorization: AWS %s:%s", aws_access_key, signature)) ;
 	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header) ;
@@ -284,12 +369,482 @@ int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t
 	} while (0) ;
 
 	curl_slist_free_all(header) ;
-	curl_easy_cleanup(curl) ;
-	curl_global_cleanup() ;
+	aws_curl_release(curl) ;
 
 	return	ret ;
 }
 
+/** @fn int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t data_n, const char * content_type, int public_read)
+    @brief	AWS S3로 파일 업로드
+    @param	r		request_rec. 메모리 할당, 에러 로깅
+    @param	path		파일명 포함한 경로
+    @param	data		파일 데이터
+    @param	data_n		데이터 사이즈
+    @param	content_type	데이터 Content-Type
+    @param	public_read	1이면 public 권한으로 업로드, 1이 아니면 private 권한으로 업로드
+    @return	성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t data_n, const char * content_type, int public_read)
+{
+	if (data_n <= 0)
+		return	FAIL ;
+
+	return	s3_put_object(r, path, data, data_n, content_type, public_read, NULL) ;
+}
+
+/** @fn int	tb_s3_upload_part (request_rec * r, const char * path, const MULTIPART_PART_T * part, int public_read)
+    @brief	multipart file 을 AWS S3로 업로드. 임시 파일에 mmap 된 part 도 복사하지 않고 바로 전송함.
+		REQUEST_PARSE_DIGEST_MD5 로 파싱한 경우 받으면서 계산한 MD5 로 Content-MD5 를 보냄. 빈 file 은 빈 object 로 업로드함
+    @param	r		request_rec. 메모리 할당, 에러 로깅
+    @param	path		파일명 포함한 경로
+    @param	part		request_params_parse 로 파싱한 multipart file. Content-Type 은 part 의 값을 사용
+    @param	public_read	1이면 public 권한으로 업로드, 1이 아니면 private 권한으로 업로드
+    @return	성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_s3_upload_part (request_rec * r, const char * path, const MULTIPART_PART_T * part, int public_read)
+{
+	if (!part || !part->data)
+		return	FAIL ;
+
+	const char *	content_type = part->content_type && *part->content_type ? part->content_type : "application/octet-stream" ;
+	return	s3_put_object(r, path, part->data, part->data_n, content_type, public_read, part->digests & MULTIPART_DIGEST_MD5 ? part->md5 : NULL) ;
+}
+
+/* S3 multipart upload 한 part 최소 크기. 마지막 part 를 제외하고 이 크기 이상이어야 함 */
+#define	S3_PART_SIZE_MIN	(5 * 1024 * 1024)
+
+/* tb_s3_upload_request 에서 params 에 넣을 form field 최대 크기 */
+#define	S3_FIELD_MAX		65536
+
+static	size_t	s3_part_size = S3_PART_SIZE_MIN ;
+
+/** @fn void	tb_set_s3_part_size (size_t size)
+    @brief	tb_s3_stream_* 에서 버퍼링할 크기 설정. 버퍼가 차면 S3 multipart upload 의 part 하나로 전송함
+    @param	size	byte 단위 크기. 5MB 보다 작으면 5MB (기본값)
+*/
+void	tb_set_s3_part_size (size_t size)
+{
+	s3_part_size = size > S3_PART_SIZE_MIN ? size : S3_PART_SIZE_MIN ;
+}
+
+struct	S3_STREAM_T
+{
+	request_rec *		r ;
+	const char *		path ;
+	const char *		content_type ;
+	int			public_read ;
+
+	char *			buf ;
+	size_t			buf_n ;
+	size_t			buf_size ;
+
+	const unsigned char *	md5 ;		/* 한 번에 업로드하는 경우 보낼 Content-MD5 */
+	const char *		upload_id ;	/* multipart upload 시작한 경우 upload id */
+	apr_array_header_t *	etags ;		/* 전송한 part 의 ETag 목록 */
+	int			failed ;
+} ;
+
+static size_t	curl_read_etag (char * ptr, size_t size, size_t nmemb, void * data)
+{
+	struct CURL_DATA *	response = (struct CURL_DATA *)data ;
+	size_t			n = size * nmemb ;
+
+	if (n > 5 && !strncasecmp(ptr, "ETag:", 5))
+	{
+		const char *	s = ptr + 5 ;
+		const char *	e = ptr + n ;
+		while (s < e && *s == ' ')
+			s++ ;
+		while (e > s && (e[-1] == '\r' || e[-1] == '\n' || e[-1] == ' '))
+			e-- ;
+		APR_ARRAY_PUSH(response->a, const char *) = apr_pstrmemdup(response->pool, s, e - s) ;
+	}
+
+	return	n ;
+}
+
+/* xml 응답에서 처음 나오는 tag 값 읽기 */
+static	const char *	s3_xml_value (apr_pool_t * pool, const char * body, const char * tag)
+{
+	const char *	open = apr_pstrcat(pool, "<", tag, ">", NULL) ;
+	const char *	s = strstr(body, open) ;
+	if (! s)
+		return	NULL ;
+
+	s += strlen(open) ;
+	const char *	e = strstr(s, apr_pstrcat(pool, "</", tag, ">", NULL)) ;
+
+	return	e ? apr_pstrmemdup(pool, s, e - s) : NULL ;
+}
+
+/* S3 multipart upload REST 요청. subresource 는 서명에 포함하는 query string.
+   성공시 response body 반환하고 etag 가 NULL 이 아니면 ETag header 저장. 실패시 NULL 반환 */
+static	const char *	s3_multipart_request (S3_STREAM_T * stream, const char * method, const char * subresource, const char * content_type, const char * data, size_t data_n, const char ** etag)
+{
+	request_rec *	r = stream->r ;
+	int		acl = stream->public_read && !strcmp(subresource, "uploads") ;
+
+	time_t		now = time(NULL) ;
+	struct tm	now_tm ;
+	localtime_r(&now, &now_tm) ;
+
+	const char *	date = tb_date_header_value(r->pool, now_tm) ;
+
+	/* 참고: http://docs.aws.amazon.com/AmazonS3/latest/dev/RESTAuthentication.html#ConstructingTheCanonicalizedResourceElement */
+	const char *	string_to_sign = apr_psprintf(r->pool, "%s\n\n%s\n%s\n%s/%s/%s?%s", method, content_type ? : "", date, acl ? "x-amz-acl:public-read\n" : "", s3_bucket, stream->path, subresource) ;
+	const char *	signature = tb_aws_signature(r->pool, aws_secret_key, string_to_sign, 1) ;
+	if (! signature)
+		return	NULL ;
+
+	CURL *		curl ;
+	CURLcode	res ;
+
+	curl = aws_curl_acquire() ;
+	if (! curl)
+		return	NULL ;
+
+	/* Header 추가 */
+	struct curl_slist *	header = NULL ;
+	const char *		host = apr_psprintf(r->pool, "%s.s3.amazonaws.com", s3_bucket) ;
+	header = curl_slist_append(header, apr_psprintf(r->pool, "Host: %s", host)) ;
+	if (acl) header = curl_slist_append(header, "x-amz-acl: public-read") ;
+	if (content_type) header = curl_slist_append(header, apr_psprintf(r->pool, "Content-Type: %s", content_type)) ;
+	header = curl_slist_append(header, apr_psprintf(r->pool, "Date: %s", date)) ;
+	header = curl_slist_append(header, apr_psprintf(r->pool, "Authorization: AWS %s:%s", aws_access_key, signature)) ;
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header) ;
+
+	const char *	url = apr_psprintf(r->pool, "http://%s/%s?%s", host, stream->path, subresource) ;
+	curl_easy_setopt(curl, CURLOPT_URL, url) ;
+
+	struct	PUT_DATA	put_data = { .data = data, .len = data_n } ;
+	if (! strcmp(method, "PUT"))
+	{
+		curl_easy_setopt(curl, CURLOPT_READFUNCTION, curl_read_put_data) ;
+		curl_easy_setopt(curl, CURLOPT_UPLOAD, 1) ;
+		curl_easy_setopt(curl, CURLOPT_READDATA, &put_data) ;
+		curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)data_n) ;
+	}
+	else if (! strcmp(method, "POST"))
+	{
+		curl_easy_setopt(curl, CURLOPT_POST, 1) ;
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data ? : "") ;
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)data_n) ;
+	}
+	else
+		curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method) ;
+
+	/* timeout 설정. part 전송은 크기가 크므로 여유있게 설정 */
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, data_n > S3_PART_SIZE_MIN / 2 ? 60 : 10) ;
+
+	struct CURL_DATA	body = { .pool = r->pool, .a = apr_array_make(r->pool, 4, sizeof(char *)) } ;
+	struct CURL_DATA	etags = { .pool = r->pool, .a = apr_array_make(r->pool, 1, sizeof(char *)) } ;
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_append_response) ;
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body) ;
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_read_etag) ;
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, &etags) ;
+
+	const char *	response = NULL ;
+	do {
+		res = curl_easy_perform(curl) ;
+		if (res != CURLE_OK)
+		{
+			TB_LOG_ERROR(r, "%s: curl_easy_perform URL: [%s] failed: %s", __FUNCTION__, url, curl_easy_strerror(res)) ;
+			break ;
+		}
+
+		long	response_code = 0 ;
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code) ;
+		response = apr_array_pstrcat(r->pool, body.a, 0) ;
+
+		/* CompleteMultipartUpload 는 200 응답이어도 body 에 Error 가 올 수 있음 */
+		if ((response_code != 200 && response_code != 204) || strstr(response, "<Error>"))
+		{
+			TB_LOG_ERROR(r, "%s: response failed: %ld: URL: [%s] response: [%s]", __FUNCTION__, response_code, url, response) ;
+			response = NULL ;
+			break ;
+		}
+
+		if (etag)
+			*etag = etags.a->nelts ? APR_ARRAY_IDX(etags.a, 0, const char *) : NULL ;
+	} while (0) ;
+
+	curl_slist_free_all(header) ;
+	aws_curl_release(curl) ;
+
+	return	response ;
+}
+
+/* 버퍼에 쌓인 데이터를 part 하나로 전송. 처음 전송할 때 multipart upload 시작 */
+static	int	s3_stream_flush (S3_STREAM_T * stream)
+{
+	apr_pool_t *	pool = stream->r->pool ;
+
+	if (! stream->upload_id)
+	{
+		const char *	response = s3_multipart_request(stream, "POST", "uploads", stream->content_type, NULL, 0, NULL) ;
+		if (!response || !(stream->upload_id = s3_xml_value(pool, response, "UploadId")))
+			return	FAIL ;
+	}
+
+	const char *	etag = NULL ;
+	char		part_number [TB_NUMBER_BUF_SIZE] ;
+	tb_ltoa(part_number, stream->etags->nelts + 1) ;
+
+	const char *	subresource = apr_pstrcat(pool, "partNumber=", part_number, "&uploadId=", stream->upload_id, NULL) ;
+	if (! s3_multipart_request(stream, "PUT", subresource, NULL, stream->buf, stream->buf_n, &etag) || !etag)
+		return	FAIL ;
+
+	APR_ARRAY_PUSH(stream->etags, const char *) = etag ;
+	stream->buf_n = 0 ;
+
+	return	SUCCESS ;
+}
+
+/** @fn S3_STREAM_T *	tb_s3_stream_open (request_rec * r, const char * path, const char * content_type, int public_read)
+    @brief	크기를 모르는 데이터를 AWS S3로 나눠서 업로드. tb_s3_stream_write 로 쓰면 tb_set_s3_part_size 크기만큼만 버퍼링하고
+		버퍼가 찰 때마다 S3 multipart upload 로 전송함. 전체가 버퍼 크기보다 작으면 tb_s3_upload 와 같이 한 번에 업로드
+    @param	r		request_rec. 메모리 할당, 에러 로깅
+    @param	path		파일명 포함한 경로
+    @param	content_type	데이터 Content-Type
+    @param	public_read	1이면 public 권한으로 업로드, 1이 아니면 private 권한으로 업로드
+    @return	업로드 stream. 실패시 NULL 반환
+*/
+S3_STREAM_T *	tb_s3_stream_open (request_rec * r, const char * path, const char * content_type, int public_read)
+{
+	if (!path || !*aws_access_key || !*aws_secret_key)
+		return	NULL ;
+
+	S3_STREAM_T *	stream = apr_pcalloc(r->pool, sizeof(S3_STREAM_T)) ;
+	stream->r = r ;
+	stream->path = apr_pstrdup(r->pool, path) ;
+	stream->content_type = apr_pstrdup(r->pool, content_type && *content_type ? content_type : "application/octet-stream") ;
+	stream->public_read = public_read ;
+	stream->buf_size = s3_part_size ;
+	stream->buf = apr_palloc(r->pool, stream->buf_size) ;
+	stream->etags = apr_array_make(r->pool, 4, sizeof(const char *)) ;
+
+	return	stream ;
+}
+
+/** @fn int	tb_s3_stream_write (S3_STREAM_T * stream, const char * data, size_t data_n)
+    @brief	업로드할 데이터 쓰기. 버퍼가 차면 part 하나를 전송한 후 반환
+    @param	stream	tb_s3_stream_open 결과
+    @param	data	데이터
+    @param	data_n	데이터 사이즈
+    @return	성공시 SUCCESS, 실패시 FAIL. 실패한 경우 tb_s3_stream_close 에서 업로드를 취소함
+*/
+int	tb_s3_stream_write (S3_STREAM_T * stream, const char * data, size_t data_n)
+{
+	if (!stream || stream->failed)
+		return	FAIL ;
+
+	while (data_n)
+	{
+		size_t	n = stream->buf_size - stream->buf_n ;
+		if (n > data_n)
+			n = data_n ;
+
+		memcpy(stream->buf + stream->buf_n, data, n) ;
+		stream->buf_n += n ;
+		data += n ;
+		data_n -= n ;
+
+		if (stream->buf_n == stream->buf_size && s3_stream_flush(stream) != SUCCESS)
+		{
+			stream->failed = 1 ;
+			return	FAIL ;
+		}
+	}
+
+	return	SUCCESS ;
+}
+
+/** @fn void	tb_s3_stream_abort (S3_STREAM_T * stream)
+    @brief	업로드 취소. 이미 전송한 part 를 S3 에서 삭제함
+    @param	stream	tb_s3_stream_open 결과
+*/
+void	tb_s3_stream_abort (S3_STREAM_T * stream)
+{
+	if (!stream || !stream->upload_id)
+		return ;
+
+	s3_multipart_request(stream, "DELETE", apr_psprintf(stream->r->pool, "uploadId=%s", stream->upload_id), NULL, NULL, 0, NULL) ;
+	stream->upload_id = NULL ;
+	stream->failed = 1 ;
+}
+
+/** @fn int	tb_s3_stream_close (S3_STREAM_T * stream)
+    @brief	남은 데이터를 전송하고 업로드 완료. 실패시 업로드를 취소함. 쓴 데이터가 없으면 빈 object 를 만듦
+    @param	stream	tb_s3_stream_open 결과
+    @return	성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_s3_stream_close (S3_STREAM_T * stream)
+{
+	if (! stream)
+		return	FAIL ;
+
+	if (stream->failed)
+	{
+		tb_s3_stream_abort(stream) ;
+		return	FAIL ;
+	}
+
+	/* 버퍼 크기보다 작으면 한 번에 업로드 */
+	if (! stream->upload_id)
+		return	s3_put_object(stream->r, stream->path, stream->buf, stream->buf_n, stream->content_type, stream->public_read, stream->md5) ;
+
+	if (stream->buf_n && s3_stream_flush(stream) != SUCCESS)
+	{
+		tb_s3_stream_abort(stream) ;
+		return	FAIL ;
+	}
+
+	apr_pool_t *		pool = stream->r->pool ;
+	apr_array_header_t *	xml = apr_array_make(pool, stream->etags->nelts + 2, sizeof(const char *)) ;
+	char			part_number [TB_NUMBER_BUF_SIZE] ;
+	int			i ;
+
+	APR_ARRAY_PUSH(xml, const char *) = "<CompleteMultipartUpload>" ;
+	for (i = 0; i < stream->etags->nelts; i++)
+	{
+		tb_ltoa(part_number, i + 1) ;
+		APR_ARRAY_PUSH(xml, const char *) = apr_pstrcat(pool, "<Part><PartNumber>", part_number, "</PartNumber><ETag>", APR_ARRAY_IDX(stream->etags, i, const char *), "</ETag></Part>", NULL) ;
+	}
+	APR_ARRAY_PUSH(xml, const char *) = "</CompleteMultipartUpload>" ;
+
+	const char *	body = apr_array_pstrcat(pool, xml, 0) ;
+	if (! s3_multipart_request(stream, "POST", apr_psprintf(pool, "uploadId=%s", stream->upload_id), "application/xml", body, strlen(body), NULL))
+	{
+		tb_s3_stream_abort(stream) ;
+		return	FAIL ;
+	}
+
+	stream->upload_id = NULL ;
+
+	return	SUCCESS ;
+}
+
+/* tb_s3_upload_request 에서 multipart parser callback 에 전달하는 상태 */
+typedef struct
+{
+	request_rec *	r ;
+	const char *	key ;
+	const char *	path ;
+	int		public_read ;
+	apr_table_t *	params ;
+
+	S3_STREAM_T *	stream ;	/* 업로드 중인 file part */
+	int		uploaded ;
+
+	char *		field ;		/* 읽는 중인 form field 값 */
+	size_t		field_n ;
+	size_t		field_size ;
+} S3_PIPE_T ;
+
+static	int	s3_pipe_part_begin (void * data, MULTIPART_PART_T * part)
+{
+	S3_PIPE_T *	upload = (S3_PIPE_T *)data ;
+
+	upload->field_n = 0 ;
+	if (!part->filename || !*part->filename)
+		return	SUCCESS ;
+
+	/* 처음 매칭되는 file part 하나만 업로드 */
+	if (upload->uploaded || (upload->key && (!part->key || strcmp(part->key, upload->key))))
+		return	SUCCESS ;
+
+	upload->stream = tb_s3_stream_open(upload->r, upload->path, part->content_type, upload->public_read) ;
+
+	return	upload->stream ? SUCCESS : FAIL ;
+}
+
+static	int	s3_pipe_part_data (void * data, MULTIPART_PART_T * part, const char * buf, size_t len)
+{
+	S3_PIPE_T *	upload = (S3_PIPE_T *)data ;
+
+	if (upload->stream)
+		return	tb_s3_stream_write(upload->stream, buf, len) ;
+
+	if (!upload->params || !part->key || (part->filename && *part->filename))
+		return	SUCCESS ;
+
+	if (upload->field_n + len > S3_FIELD_MAX)
+	{
+		TB_LOG_WARN(upload->r, "%s: form field [%s] exceeds [%d].", __FUNCTION__, part->key, S3_FIELD_MAX) ;
+		return	FAIL ;
+	}
+
+	if (upload->field_n + len > upload->field_size)
+	{
+		size_t	size = upload->field_size ? upload->field_size : 256 ;
+		while (size < upload->field_n + len)
+			size *= 2 ;
+
+		char *	grow = apr_palloc(upload->r->pool, size) ;
+		if (upload->field_n)
+			memcpy(grow, upload->field, upload->field_n) ;
+		upload->field = grow ;
+		upload->field_size = size ;
+	}
+
+	memcpy(upload->field + upload->field_n, buf, len) ;
+	upload->field_n += len ;
+
+	return	SUCCESS ;
+}
+
+static	int	s3_pipe_part_end (void * data, MULTIPART_PART_T * part)
+{
+	S3_PIPE_T *	upload = (S3_PIPE_T *)data ;
+
+	if (upload->stream)
+	{
+		S3_STREAM_T *	stream = upload->stream ;
+		upload->stream = NULL ;
+		if (part->digests & MULTIPART_DIGEST_MD5)
+			stream->md5 = part->md5 ;
+		if (tb_s3_stream_close(stream) != SUCCESS)
+			return	FAIL ;
+
+		upload->uploaded = 1 ;
+		return	SUCCESS ;
+	}
+
+	if (upload->params && part->key && *part->key && (!part->filename || !*part->filename))
+		apr_table_setn(upload->params, part->key, apr_pstrmemdup(upload->r->pool, upload->field ? : "", upload->field_n)) ;
+
+	return	SUCCESS ;
+}
+
+/** @fn int	tb_s3_upload_request (request_rec * r, const char * key, const char * path, int public_read, apr_table_t * params)
+    @brief	multipart request 의 file 을 버퍼링하지 않고 받는 대로 AWS S3로 업로드. request_params_parse 대신 사용하며
+		메모리는 tb_set_s3_part_size 크기만 사용함. 받는 동안 part 단위로 전송하므로 업로드 시간이 수신 시간과 겹침
+    @param	r		request_rec. 메모리 할당, 에러 로깅
+    @param	key		업로드할 file 의 form field 이름. NULL 이면 첫번째 file
+    @param	path		파일명 포함한 경로
+    @param	public_read	1이면 public 권한으로 업로드, 1이 아니면 private 권한으로 업로드
+    @param	params		file 이 아닌 form field 를 추가할 table. NULL 이면 추가하지 않음
+    @return	file 업로드 성공시 SUCCESS, 실패하거나 file 이 없는 경우 FAIL
+*/
+int	tb_s3_upload_request (request_rec * r, const char * key, const char * path, int public_read, apr_table_t * params)
+{
+	static const MULTIPART_CALLBACK_T	callback = {
+		.part_begin = s3_pipe_part_begin,
+		.part_data = s3_pipe_part_data,
+		.part_end = s3_pipe_part_end,
+		.digests = MULTIPART_DIGEST_MD5,
+	} ;
+	S3_PIPE_T	upload = { .r = r, .key = key, .path = path, .public_read = public_read, .params = params } ;
+
+	int	ret = tb_request_multipart_parse(r, &callback, &upload) ;
+
+	/* 파싱 중에 실패한 경우 업로드 중인 part 취소 */
+	if (upload.stream)
+		tb_s3_stream_abort(upload.stream) ;
+
+	return	ret == SUCCESS && upload.uploaded ? SUCCESS : FAIL ;
+}
+
 /** @fn	int	tb_s3_delete (request_rec * r, const char * path)
     @brief	AWS S3 파일 삭제
     @param	r	request_rec. 메모리 할당, 에러 로깅
@@ -316,13 +871,9 @@ int	tb_s3_delete (request_rec * r, const char * path)
 	CURL *		curl ;
 	CURLcode	res ;
 
-	curl_global_init(CURL_GLOBAL_DEFAULT) ;
-	curl = curl_easy_init() ;
+	curl = aws_curl_acquire() ;
 	if (! curl)
-	{
-		curl_global_cleanup() ;
 		return	FAIL ;
-	}
 
 	/* Header 추가 */
 	struct curl_slist *	header = NULL ;
@@ -360,8 +911,7 @@ int	tb_s3_delete (request_rec * r, const char * path)
 	} while (0) ;
 
 	curl_slist_free_all(header) ;
-	curl_easy_cleanup(curl) ;
-	curl_global_cleanup() ;
+	aws_curl_release(curl) ;
 
 	return	ret ;
 }
@@ -396,13 +946,9 @@ int	tb_s3_move (request_rec * r, const char * src_path, const char * dest_path,
 	CURL *		curl ;
 	CURLcode	res ;
 
-	curl_global_init(CURL_GLOBAL_DEFAULT) ;
-	curl = curl_easy_init() ;
+	curl = aws_curl_acquire() ;
 	if (! curl)
-	{
-		curl_global_cleanup() ;
 		return	FAIL ;
-	}
 
 	/* Header 추가 */
 	struct curl_slist *	header = NULL ;
@@ -445,45 +991,289 @@ int	tb_s3_move (request_rec * r, const char * src_path, const char * dest_path,
 		ret = SUCCESS ;
 	} while (0) ;
 
-	curl_slist_free_all(header) ;
-	curl_easy_cleanup(curl) ;
-	curl_global_cleanup() ;
+	curl_slist_free_all(header) ;
+	aws_curl_release(curl) ;
+
+	if (ret == SUCCESS)
+		ret = tb_s3_delete(r, src_path) ;
+
+	return	ret ;
+}
+
+enum
+{
+	AWS_SERVICE_SQS = 0,
+	AWS_SERVICE_SNS,
+
+	AWS_SERVICE_NUMBER
+} ;
+
+static	struct
+{
+	const char *	name ;
+	const char *	domain ;
+	const char *	version ;
+} aws_service_list [] =
+{
+	[AWS_SERVICE_SQS] = {	"sqs",	"sqs.ap-northeast-1.amazonaws.com",	"2012-11-05"	},
+	[AWS_SERVICE_SNS] = {	"sns",	"sns.ap-northeast-1.amazonaws.com",	"2010-03-31"	},
+} ;
+
+/* SigV4 signing key 캐시. k_signing 은 날짜, region, service 가 같으면 바뀌지 않으므로
+   service 별로 한 번 만들어 두고, HMAC ipad/opad 까지 적용한 SHA-256 context 를 복사해서 서명에 사용 */
+static	struct
+{
+	pthread_rwlock_t	lock ;
+	char			date [9] ;
+	char			region [32] ;
+	unsigned int		generation ;
+	EVP_MD_CTX *		inner ;
+	EVP_MD_CTX *		outer ;
+} aws_signing_keys [AWS_SERVICE_NUMBER] =
+{
+	[0 ... AWS_SERVICE_NUMBER - 1] = { .lock = PTHREAD_RWLOCK_INITIALIZER }
+} ;
+
+static	int	aws_signing_key_valid (int service, const char * date_short, const char * region)
+{
+	return	aws_signing_keys[service].inner && aws_signing_keys[service].generation == aws_key_generation && !strcmp(aws_signing_keys[service].date, date_short) && !strcmp(aws_signing_keys[service].region, region) ;
+}
+
+/* k_date -> k_region -> k_service -> k_signing 유도하고 ipad/opad 적용한 context 생성. write lock 잡고 호출해야 함 */
+static	int	aws_signing_key_derive (int service, const char * date_short, const char * region)
+{
+	const char *	name = aws_service_list[service].name ;
+	const char *	data[] = { date_short, region, name, "aws4_request" } ;
+	unsigned char	k[4 + sizeof(aws_secret_key)] ;	/* "AWS4" + secret key. 이후 HMAC 결과 저장 */
+	unsigned int	k_n = snprintf((char *)k, sizeof(k), "AWS4%s", aws_secret_key) ;
+	unsigned char	pad[64] ;	/* SHA-256 block 크기 */
+	int		i ;
+
+	if (k_n >= sizeof(k) || strlen(date_short) >= _N(aws_signing_keys[service].date) || strlen(region) >= _N(aws_signing_keys[service].region))
+		return	FAIL ;
+
+	for (i = 0; i < _N(data); i++)
+	{
+		if (! HMAC(EVP_sha256(), k, k_n, (const unsigned char *)data[i], strlen(data[i]), k, &k_n))
+			return	FAIL ;
+	}
+
+	if (! aws_signing_keys[service].inner)
+		aws_signing_keys[service].inner = EVP_MD_CTX_new() ;
+	if (! aws_signing_keys[service].outer)
+		aws_signing_keys[service].outer = EVP_MD_CTX_new() ;
+
+	EVP_MD_CTX *	inner = aws_signing_keys[service].inner ;
+	EVP_MD_CTX *	outer = aws_signing_keys[service].outer ;
+	int		ret = FAIL ;
+
+	aws_signing_keys[service].date[0] = '\0' ;
+	if (inner && outer)
+	{
+		for (i = 0; i < sizeof(pad); i++)
+			pad[i] = (i < k_n ? k[i] : 0) ^ 0x36 ;
+		if (EVP_DigestInit_ex(inner, EVP_sha256(), NULL) && EVP_DigestUpdate(inner, pad, sizeof(pad)))
+		{
+			for (i = 0; i < sizeof(pad); i++)
+				pad[i] = (i < k_n ? k[i] : 0) ^ 0x5c ;
+			if (EVP_DigestInit_ex(outer, EVP_sha256(), NULL) && EVP_DigestUpdate(outer, pad, sizeof(pad)))
+				ret = SUCCESS ;
+		}
+	}
+
+	OPENSSL_cleanse(k, sizeof(k)) ;
+	OPENSSL_cleanse(pad, sizeof(pad)) ;
+
+	if (ret == SUCCESS)
+	{
+		strcpy(aws_signing_keys[service].date, date_short) ;
+		strcpy(aws_signing_keys[service].region, region) ;
+		aws_signing_keys[service].generation = aws_key_generation ;
+	}
+
+	return	ret ;
+}
+
+/* 캐시한 signing key 로 string_to_sign 의 HMAC-SHA256 을 hex 로 signature 에 저장. 날짜가 바뀌었으면 key 다시 유도 */
+static	int	aws_sign_v4 (int service, const char * date_short, const char * region, const char * string_to_sign, char * signature)
+{
+	EVP_MD_CTX *	ctx = EVP_MD_CTX_new() ;
+	unsigned char	md[EVP_MAX_MD_SIZE] ;
+	unsigned int	md_n = 0 ;
+	int		ret = FAIL ;
+
+	if (! ctx)
+		return	FAIL ;
+
+	pthread_rwlock_rdlock(&aws_signing_keys[service].lock) ;
+	if (! aws_signing_key_valid(service, date_short, region))
+	{
+		/* 다른 thread 가 먼저 갱신했을 수 있으므로 write lock 잡고 다시 확인 */
+		pthread_rwlock_unlock(&aws_signing_keys[service].lock) ;
+		pthread_rwlock_wrlock(&aws_signing_keys[service].lock) ;
+		if (! aws_signing_key_valid(service, date_short, region))
+			aws_signing_key_derive(service, date_short, region) ;
+	}
+
+	if (aws_signing_key_valid(service, date_short, region)
+		&& EVP_MD_CTX_copy_ex(ctx, aws_signing_keys[service].inner) && EVP_DigestUpdate(ctx, string_to_sign, strlen(string_to_sign)) && EVP_DigestFinal_ex(ctx, md, &md_n)
+		&& EVP_MD_CTX_copy_ex(ctx, aws_signing_keys[service].outer) && EVP_DigestUpdate(ctx, md, md_n) && EVP_DigestFinal_ex(ctx, md, &md_n))
+		ret = SUCCESS ;
+	pthread_rwlock_unlock(&aws_signing_keys[service].lock) ;
+
+	EVP_MD_CTX_free(ctx) ;
+
+	if (ret == SUCCESS)
+		tb_hex_encode(signature, md, md_n) ;
+
+	return	ret ;
+}
+
+/** @fn void	tb_aws_final (void)
+    @brief	AWS 종료 : 보관 중인 curl handle, 연결, signing key 캐시 정리. child exit 에서 호출
+*/
+void	tb_aws_final (void)
+{
+	pthread_mutex_lock(&aws_curl_lock) ;
+	while (aws_curl_pool_n > 0)
+		curl_easy_cleanup(aws_curl_pool[--aws_curl_pool_n]) ;
+	pthread_mutex_unlock(&aws_curl_lock) ;
+
+	/* 다른 thread 의 CURLSH 는 thread 종료시 정리됨 */
+	CURLSH *	share = !aws_curl_initialized ? NULL : pthread_getspecific(aws_curl_share_key) ;
+	if (share)
+	{
+		pthread_setspecific(aws_curl_share_key, NULL) ;
+		curl_share_cleanup(share) ;
+	}
+
+	int	i ;
+	for (i = 0; i < AWS_SERVICE_NUMBER; i++)
+	{
+		pthread_rwlock_wrlock(&aws_signing_keys[i].lock) ;
+		EVP_MD_CTX_free(aws_signing_keys[i].inner) ;
+		EVP_MD_CTX_free(aws_signing_keys[i].outer) ;
+		aws_signing_keys[i].inner = NULL ;
+		aws_signing_keys[i].outer = NULL ;
+		aws_signing_keys[i].date[0] = '\0' ;
+		pthread_rwlock_unlock(&aws_signing_keys[i].lock) ;
+	}
+}
+
+/* tb_aws_async_* 로 전송 중인 요청 하나 */
+typedef struct
+{
+	int			id ;
+	CURL *			curl ;
+	struct curl_slist *	header ;
+	const char *		url ;
+	const char *		query ;
+	const char *		data ;		/* response->data 로 전달할 값 */
+	struct CURL_DATA	body ;
+	AWS_RESPONSE_T *	response ;
+	int			done ;
+	AWS_ASYNC_CALLBACK_T	callback ;
+	void *			callback_data ;
+} AWS_ASYNC_REQUEST_T ;
+
+struct	AWS_ASYNC_T
+{
+	request_rec *		r ;
+	CURLM *			multi ;
+	apr_array_header_t *	requests ;	/* AWS_ASYNC_REQUEST_T * array. index 가 request id */
+	int			pending ;
+} ;
+
+/* 전송 끝난 요청 정리. curl handle 은 pool 에 반납하고 callback 호출 */
+static	void	aws_async_complete (AWS_ASYNC_T * async, AWS_ASYNC_REQUEST_T * req, CURLcode res)
+{
+	request_rec *	r = async->r ;
 
-	if (ret == SUCCESS)
-		ret = tb_s3_delete(r, src_path) ;
+	if (res == CURLE_OK)
+	{
+		req->response = apr_palloc(r->pool, sizeof(AWS_RESPONSE_T)) ;
+		req->response->body = apr_array_pstrcat(r->pool, req->body.a, 0) ;
+		req->response->data = req->data ;
 
-	return	ret ;
+		curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &(req->response->status)) ;
+		if (req->response->status != 200)
+			TB_LOG_ERROR(r, "%s: response failed: %ld: URL: [%s] POST: [%s] response: [%s]", __FUNCTION__, req->response->status, req->url, req->query, req->response->body) ;
+	}
+	else
+		TB_LOG_ERROR(r, "%s: curl URL: [%s] POST: [%s] failed: %s", __FUNCTION__, req->url, req->query, curl_easy_strerror(res)) ;
+
+	curl_multi_remove_handle(async->multi, req->curl) ;
+	curl_slist_free_all(req->header) ;
+	aws_curl_release(req->curl) ;
+	req->curl = NULL ;
+	req->header = NULL ;
+	req->done = 1 ;
+	async->pending-- ;
+
+	if (req->callback)
+		req->callback(req->callback_data, req->id, req->response) ;
 }
 
-enum
+/* pool 정리할 때 전송 중인 요청 취소 */
+static	apr_status_t	aws_async_cleanup (void * data)
 {
-	AWS_SERVICE_SQS = 0,
-	AWS_SERVICE_SNS,
+	AWS_ASYNC_T *	async = (AWS_ASYNC_T *)data ;
+	int		i ;
 
-	AWS_SERVICE_NUMBER
-} ;
+	for (i = 0; i < async->requests->nelts; i++)
+	{
+		AWS_ASYNC_REQUEST_T *	req = APR_ARRAY_IDX(async->requests, i, AWS_ASYNC_REQUEST_T *) ;
+		if (req->done)
+			continue ;
+
+		curl_multi_remove_handle(async->multi, req->curl) ;
+		curl_slist_free_all(req->header) ;
+		aws_curl_release(req->curl) ;
+		req->done = 1 ;
+	}
 
-static	struct
-{
-	const char *	name ;
-	const char *	domain ;
-	const char *	version ;
-} aws_service_list [] =
-{
-	[AWS_SERVICE_SQS] = {	"sqs",	"sqs.ap-northeast-1.amazonaws.com",	"2012-11-05"	},
-	[AWS_SERVICE_SNS] = {	"sns",	"sns.ap-northeast-1.amazonaws.com",	"2010-03-31"	},
-} ;
+	async->pending = 0 ;
+	curl_multi_cleanup(async->multi) ;
 
-static	AWS_RESPONSE_T *	send_aws_request (request_rec * r, int service, const char * path, const char * params_url)
+	return	APR_SUCCESS ;
+}
+
+/** @fn AWS_ASYNC_T *	tb_aws_async_make (request_rec * r)
+    @brief	AWS 요청 여러 개를 한 thread 에서 동시에 보내기 위한 curl multi 생성. tb_sqs_send_async, tb_sns_push_send_async 로
+		요청을 추가하고 tb_aws_async_wait_any, tb_aws_async_wait_all 로 완료 대기. 끝나지 않은 요청은 r->pool 정리할 때 취소됨
+    @param	r	request_rec. 메모리 할당, 에러 로깅
+    @return	생성한 AWS_ASYNC_T. 실패시 NULL
+*/
+AWS_ASYNC_T *	tb_aws_async_make (request_rec * r)
 {
-	if (service < 0 || service >= AWS_SERVICE_NUMBER || !path || !params_url)
+	pthread_once(&aws_curl_once, aws_curl_init) ;
+
+	CURLM *	multi = curl_multi_init() ;
+	if (! multi)
 		return	NULL ;
 
+	AWS_ASYNC_T *	async = apr_pcalloc(r->pool, sizeof(AWS_ASYNC_T)) ;
+	async->r = r ;
+	async->multi = multi ;
+	async->requests = apr_array_make(r->pool, 4, sizeof(AWS_ASYNC_REQUEST_T *)) ;
+	apr_pool_cleanup_register(r->pool, async, aws_async_cleanup, apr_pool_cleanup_null) ;
+
+	return	async ;
+}
+
+/* SigV4 서명한 SQS, SNS 요청을 async 에 추가. 성공시 request id, 실패시 FAIL */
+static	int	aws_async_submit (AWS_ASYNC_T * async, int service, const char * path, const char * params_url, const char * data, AWS_ASYNC_CALLBACK_T callback, void * callback_data)
+{
+	if (!async || service < 0 || service >= AWS_SERVICE_NUMBER || !path || !params_url)
+		return	FAIL ;
+
 	/* 참고
 		http://docs.aws.amazon.com/AWSSimpleQueueService/latest/SQSDeveloperGuide/MakingRequests_MakingQueryRequestsArticle.html
 		http://docs.aws.amazon.com/general/latest/gr/sigv4_signing.html
 	*/
 
+	request_rec *	r = async->r ;
+	const char *	region = "ap-northeast-1" ;
 	time_t		now = time(NULL) ;
 	struct tm	now_tm ;
 	localtime_r(&now, &now_tm) ;
@@ -496,37 +1286,37 @@ static	AWS_RESPONSE_T *	send_aws_request (request_rec * r, int service, const ch
 	const char *	canonical_request = apr_psprintf(r->pool, "POST\n%s\n\ncontent-type:application/x-www-form-urlencoded\nhost:%s\n\ncontent-type;host\n%s", path, aws_service_list[service].domain, hashed_payload) ; 
 
 	const char *	hashed_canonical_request = tb_sha256_hash(r->pool, canonical_request) ;
-	const char *	credential_scope = apr_psprintf(r->pool, "%s/ap-northeast-1/%s/aws4_request", date_short, aws_service_list[service].name) ;
+	const char *	credential_scope = apr_psprintf(r->pool, "%s/%s/%s/aws4_request", date_short, region, aws_service_list[service].name) ;
 	const char *	string_to_sign = apr_psprintf(r->pool, "AWS4-HMAC-SHA256\n%.15sZ\n%s\n%s", gmt_date, credential_scope, hashed_canonical_request) ;
 
-	const char *		k_secret = apr_psprintf(r->pool, "AWS4%s", aws_secret_key) ;
-	const unsigned char *	k_date = generate_hmac_sha256(r->pool, k_secret, strlen(k_secret), date_short, strlen(date_short), 1) ;
-	const unsigned char *	k_region = generate_hmac_sha256(r->pool, k_date, 32, "ap-northeast-1", 14, 1) ;
-	const unsigned char *	k_service = generate_hmac_sha256(r->pool, k_region, 32, aws_service_list[service].name, strlen(aws_service_list[service].name), 1) ;
-	const unsigned char *	k_signing = generate_hmac_sha256(r->pool, k_service, 32, "aws4_request", 12, 1) ;
-
-	const char *	signature = generate_hmac_sha256(r->pool, k_signing, 32, string_to_sign, strlen(string_to_sign), 0) ;
-	if (! signature)
-		return	NULL ;
-
-	CURL *		curl ;
-	CURLcode	res ;
+	char	signature[EVP_MAX_MD_SIZE * 2 + 1] ;
+	if (aws_sign_v4(service, date_short, region, string_to_sign, signature) != SUCCESS)
+	{
+		TB_LOG_ERROR(r, "%s: signing failed", __FUNCTION__) ;
+		return	FAIL ;
+	}
 
-	curl_global_init(CURL_GLOBAL_DEFAULT) ;
-	curl = curl_easy_init() ;
+	CURL *	curl = aws_curl_acquire() ;
 	if (! curl)
-		return	NULL ;
+		return	FAIL ;
 
-	/* Header 추가 */
-	struct curl_slist *	header = NULL ;
-	header = curl_slist_append(header, apr_psprintf(r->pool, "Host: %s", aws_service_list[service].domain)) ;
-	header = curl_slist_append(header, "Content-Type: application/x-www-form-urlencoded") ;
-	header = curl_slist_append(header, apr_psprintf(r->pool, "x-amz-date: %s", timestamp)) ;
-	header = curl_slist_append(header, apr_psprintf(r->pool, "Authorization: AWS4-HMAC-SHA256 Credential=%s/%s, SignedHeaders=content-type;host, Signature=%s", aws_access_key, credential_scope, signature)) ;
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header) ;
+	AWS_ASYNC_REQUEST_T *	req = apr_pcalloc(r->pool, sizeof(AWS_ASYNC_REQUEST_T)) ;
+	req->id = async->requests->nelts ;
+	req->curl = curl ;
+	req->query = query ;
+	req->data = data ;
+	req->callback = callback ;
+	req->callback_data = callback_data ;
 
-	const char *	url = apr_psprintf(r->pool, "http://%s%s", aws_service_list[service].domain, path) ;
-	curl_easy_setopt(curl, CURLOPT_URL, url) ;
+	/* Header 추가 */
+	req->header = curl_slist_append(req->header, apr_psprintf(r->pool, "Host: %s", aws_service_list[service].domain)) ;
+	req->header = curl_slist_append(req->header, "Content-Type: application/x-www-form-urlencoded") ;
+	req->header = curl_slist_append(req->header, apr_psprintf(r->pool, "x-amz-date: %s", timestamp)) ;
+	req->header = curl_slist_append(req->header, apr_psprintf(r->pool, "Authorization: AWS4-HMAC-SHA256 Credential=%s/%s, SignedHeaders=content-type;host, Signature=%s", aws_access_key, credential_scope, signature)) ;
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->header) ;
+
+	req->url = apr_psprintf(r->pool, "http://%s%s", aws_service_list[service].domain, path) ;
+	curl_easy_setopt(curl, CURLOPT_URL, req->url) ;
 	curl_easy_setopt(curl, CURLOPT_POST, 1) ;
 
 	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, query) ;
@@ -535,29 +1325,156 @@ static	AWS_RESPONSE_T *	send_aws_request (request_rec * r, int service, const ch
 	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10) ;
 
 	/* response 데이터 구조 초기화 */
-	curl_data.pool = r->pool ;
-	curl_data.a = apr_array_make(r->pool, 4, sizeof(char *)) ;
+	req->body.pool = r->pool ;
+	req->body.a = apr_array_make(r->pool, 4, sizeof(char *)) ;
 
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_read_response);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &curl_data);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_append_response) ;
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &req->body) ;
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, req) ;
 
-	AWS_RESPONSE_T *	response = NULL ;
-	res = curl_easy_perform(curl) ;
-	if (res == CURLE_OK)
+	CURLMcode	mc = curl_multi_add_handle(async->multi, curl) ;
+	if (mc != CURLM_OK)
+	{
+		TB_LOG_ERROR(r, "%s: curl_multi_add_handle URL: [%s] failed: %s", __FUNCTION__, req->url, curl_multi_strerror(mc)) ;
+		curl_slist_free_all(req->header) ;
+		aws_curl_release(curl) ;
+		return	FAIL ;
+	}
+
+	APR_ARRAY_PUSH(async->requests, AWS_ASYNC_REQUEST_T *) = req ;
+	async->pending++ ;
+
+	return	req->id ;
+}
+
+/* aws_async_perform 대기 방법 */
+enum
+{
+	AWS_ASYNC_POLL = 0,	/* 대기하지 않고 바로 진행할 수 있는 만큼만 전송하고 끝난 요청 처리 */
+	AWS_ASYNC_ANY,		/* 하나 이상 끝날 때까지 대기 */
+	AWS_ASYNC_ALL,		/* 모두 끝날 때까지 대기 */
+} ;
+
+/* 전송 진행. 마지막으로 완료한 request id 반환. 완료한 요청이 없으면 FAIL */
+static	int	aws_async_perform (AWS_ASYNC_T * async, int wait)
+{
+	int	completed = FAIL ;
+
+	while (async->pending > 0)
 	{
-		response = apr_palloc(r->pool, sizeof(AWS_RESPONSE_T)) ;
-		response->body = apr_array_pstrcat(r->pool, curl_data.a, 0) ;
+		int		running = 0 ;
+		int		left = 0 ;
+		CURLMsg *	msg ;
+		CURLMcode	mc = curl_multi_perform(async->multi, &running) ;
+
+		while ((msg = curl_multi_info_read(async->multi, &left)))
+		{
+			if (msg->msg != CURLMSG_DONE)
+				continue ;
+
+			AWS_ASYNC_REQUEST_T *	req = NULL ;
+			CURLcode		res = msg->data.result ;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&req) ;
+			aws_async_complete(async, req, res) ;
+			completed = req->id ;
+		}
+
+		/* AWS_ASYNC_POLL 은 대기 없이 준비된 socket 이 있는 동안만 반복 */
+		int	numfds = 0 ;
+		if (mc == CURLM_OK && async->pending > 0 && (wait != AWS_ASYNC_ANY || completed == FAIL))
+			mc = curl_multi_poll(async->multi, NULL, 0, wait == AWS_ASYNC_POLL ? 0 : 1000, &numfds) ;
+
+		if (mc != CURLM_OK)
+		{
+			/* multi 자체가 실패하면 남은 요청 모두 실패 처리 */
+			TB_LOG_ERROR(async->r, "%s: curl multi failed: %s", __FUNCTION__, curl_multi_strerror(mc)) ;
+
+			int	i ;
+			for (i = 0; i < async->requests->nelts; i++)
+			{
+				AWS_ASYNC_REQUEST_T *	req = APR_ARRAY_IDX(async->requests, i, AWS_ASYNC_REQUEST_T *) ;
+				if (req->done)
+					continue ;
+
+				aws_async_complete(async, req, CURLE_FAILED_INIT) ;
+				completed = req->id ;
+			}
+			break ;
+		}
 
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &(response->status)) ;
-		if (response->status != 200)
-			TB_LOG_ERROR(r, "%s: response failed: %ld: URL: [%s] POST: [%s] response: [%s]", __FUNCTION__, response->status, url, query, response->body) ;
+		if ((wait == AWS_ASYNC_POLL && !numfds) || (wait == AWS_ASYNC_ANY && completed != FAIL))
+			break ;
 	}
-	else
-		TB_LOG_ERROR(r, "%s: curl_easy_perform URL: [%s] POST: [%s] failed: %s", __FUNCTION__, url, query, curl_easy_strerror(res)) ;
 
-	curl_slist_free_all(header) ;
-	curl_easy_cleanup(curl) ;
-	curl_global_cleanup() ;
+	return	completed ;
+}
+
+/** @fn int	tb_aws_async_wait_any (AWS_ASYNC_T * async)
+    @brief	추가한 요청 중 하나 이상 끝날 때까지 대기. 끝난 요청마다 callback 호출
+    @param	async	tb_aws_async_make 로 생성한 AWS_ASYNC_T
+    @return	끝난 요청의 request id. 여러 개가 끝난 경우 마지막 것. 대기 중인 요청이 없으면 FAIL
+*/
+int	tb_aws_async_wait_any (AWS_ASYNC_T * async)
+{
+	if (! async)
+		return	FAIL ;
+
+	return	aws_async_perform(async, AWS_ASYNC_ANY) ;
+}
+
+/** @fn int	tb_aws_async_wait_all (AWS_ASYNC_T * async)
+    @brief	추가한 요청이 모두 끝날 때까지 대기. 끝난 요청마다 callback 호출
+    @param	async	tb_aws_async_make 로 생성한 AWS_ASYNC_T
+    @return	모든 요청이 200 응답이면 SUCCESS, 하나라도 실패하면 FAIL
+*/
+int	tb_aws_async_wait_all (AWS_ASYNC_T * async)
+{
+	if (! async)
+		return	FAIL ;
+
+	aws_async_perform(async, AWS_ASYNC_ALL) ;
+
+	int	i ;
+	for (i = 0; i < async->requests->nelts; i++)
+	{
+		AWS_ASYNC_REQUEST_T *	req = APR_ARRAY_IDX(async->requests, i, AWS_ASYNC_REQUEST_T *) ;
+		if (!req->response || req->response->status != 200)
+			return	FAIL ;
+	}
+
+	return	SUCCESS ;
+}
+
+/** @fn AWS_RESPONSE_T *	tb_aws_async_response (AWS_ASYNC_T * async, int id)
+    @brief	끝난 요청의 응답
+    @param	async	tb_aws_async_make 로 생성한 AWS_ASYNC_T
+    @param	id	tb_sqs_send_async, tb_sns_push_send_async 가 반환한 request id
+    @return	응답. 아직 끝나지 않았거나 전송 실패한 경우 NULL
+*/
+AWS_RESPONSE_T *	tb_aws_async_response (AWS_ASYNC_T * async, int id)
+{
+	if (!async || id < 0 || id >= async->requests->nelts)
+		return	NULL ;
+
+	return	APR_ARRAY_IDX(async->requests, id, AWS_ASYNC_REQUEST_T *)->response ;
+}
+
+static	AWS_RESPONSE_T *	send_aws_request (request_rec * r, int service, const char * path, const char * params_url)
+{
+	AWS_ASYNC_T *	async = tb_aws_async_make(r) ;
+	if (! async)
+		return	NULL ;
+
+	AWS_RESPONSE_T *	response = NULL ;
+	int			id = aws_async_submit(async, service, path, params_url, NULL, NULL, NULL) ;
+	if (id != FAIL)
+	{
+		aws_async_perform(async, AWS_ASYNC_ALL) ;
+		response = tb_aws_async_response(async, id) ;
+	}
+
+	/* curl multi 는 요청 끝날 때까지 두지 않고 바로 정리 */
+	apr_pool_cleanup_run(r->pool, async, aws_async_cleanup) ;
 
 	return	response ;
 }
@@ -581,6 +1498,247 @@ int	tb_sqs_send (request_rec * r, const char * endpoint, const char * body)
 	return	SUCCESS ;
 }
 
+/** @fn int	tb_sqs_send_async (AWS_ASYNC_T * async, const char * endpoint, const char * body, AWS_ASYNC_CALLBACK_T callback, void * data)
+    @brief	tb_sqs_send 를 async 에 추가하고 바로 반환. 전송은 tb_aws_async_wait_any, tb_aws_async_wait_all 에서 진행
+    @param	async		tb_aws_async_make 로 생성한 AWS_ASYNC_T
+    @param	endpoint	메세지 쌓을 SQS endpoint. e.g.) /123456789/test_sqs/
+    @param	body		메시지 본문
+    @param	callback	요청이 끝나면 호출할 함수. 전송 실패시 response 는 NULL. 필요없으면 NULL
+    @param	data		callback 에 전달할 값
+    @return	성공시 request id, 실패시 FAIL
+*/
+int	tb_sqs_send_async (AWS_ASYNC_T * async, const char * endpoint, const char * body, AWS_ASYNC_CALLBACK_T callback, void * data)
+{
+	if (!async || !endpoint || !body)
+		return	FAIL ;
+
+	apr_pool_t *	pool = async->r->pool ;
+	return	aws_async_submit(async, AWS_SERVICE_SQS, endpoint, apr_psprintf(pool, "Action=SendMessage&MessageBody=%s", tb_escape_url(pool, body)), NULL, callback, data) ;
+}
+
+/* SendMessageBatch 한 번에 보낼 수 있는 최대 메세지 수, 전체 크기 */
+#define	SQS_BATCH_ENTRY_MAX	10
+#define	SQS_BATCH_SIZE_MAX	(256 * 1024)
+
+struct	SQS_BATCH_T
+{
+	request_rec *		r ;
+	AWS_ASYNC_T *		async ;
+	const char *		endpoint ;
+	apr_interval_time_t	linger ;
+	SQS_BATCH_CALLBACK_T	callback ;
+	void *			data ;
+
+	const char *		bodies [SQS_BATCH_ENTRY_MAX] ;
+	int			ids [SQS_BATCH_ENTRY_MAX] ;
+	int			entries_n ;
+	size_t			size ;
+	apr_time_t		first_time ;	/* 버퍼에 처음 쌓은 시간 */
+
+	int			next_id ;
+	int			failed ;	/* 실패한 메세지 수 */
+} ;
+
+/* 전송한 SendMessageBatch 요청 하나 */
+typedef struct
+{
+	SQS_BATCH_T *		batch ;
+	int			ids [SQS_BATCH_ENTRY_MAX] ;
+	int			entries_n ;
+} SQS_BATCH_FLUSH_T ;
+
+static	void	sqs_batch_result (SQS_BATCH_T * batch, int id, int result, const char * error)
+{
+	if (result != SUCCESS)
+		batch->failed++ ;
+
+	if (batch->callback)
+		batch->callback(batch->data, id, result, error) ;
+}
+
+/* SendMessageBatch 응답의 entry 별 결과를 callback 으로 전달. 응답에 없는 entry 는 실패 처리 */
+static	void	sqs_batch_complete (void * data, int request_id, AWS_RESPONSE_T * response)
+{
+	SQS_BATCH_FLUSH_T *	flush = (SQS_BATCH_FLUSH_T *)data ;
+	SQS_BATCH_T *		batch = flush->batch ;
+	apr_pool_t *		pool = batch->r->pool ;
+	int			reported [SQS_BATCH_ENTRY_MAX] = { 0 } ;
+	int			i ;
+
+	if (response && response->status == 200)
+	{
+		static const	struct
+		{
+			const char *	tag ;
+			int		result ;
+		} entry_tags[] =
+		{
+			{ "<SendMessageBatchResultEntry>",	SUCCESS },
+			{ "<BatchResultErrorEntry>",		FAIL },
+		} ;
+
+		int	t ;
+		for (t = 0; t < _N(entry_tags); t++)
+		{
+			const char *	s = response->body ;
+			while ((s = strstr(s, entry_tags[t].tag)))
+			{
+				s += strlen(entry_tags[t].tag) ;
+
+				const char *	entry_id = s3_xml_value(pool, s, "Id") ;
+				int		index = -1 ;
+				if (!entry_id || tb_parse_int(entry_id, strlen(entry_id), &index) != SUCCESS || index < 0 || index >= flush->entries_n || reported[index])
+					continue ;
+
+				reported[index] = 1 ;
+				sqs_batch_result(batch, flush->ids[index], entry_tags[t].result, entry_tags[t].result == SUCCESS ? NULL : s3_xml_value(pool, s, "Code") ? : "Unknown") ;
+			}
+		}
+	}
+
+	for (i = 0; i < flush->entries_n; i++)
+	{
+		if (! reported[i])
+			sqs_batch_result(batch, flush->ids[i], FAIL, !response ? "TransportFailed" : response->status != 200 ? "RequestFailed" : "MissingResult") ;
+	}
+}
+
+/** @fn SQS_BATCH_T *	tb_sqs_batch_make (request_rec * r, const char * endpoint, int linger_ms, SQS_BATCH_CALLBACK_T callback, void * data)
+    @brief	SQS 메세지를 모아서 SendMessageBatch 로 발송하는 producer 생성. 10개 또는 256KB 가 차거나
+		처음 쌓은 메세지가 linger_ms 보다 오래되면 tb_sqs_batch_send 에서 전송 시작. 마지막에 tb_sqs_batch_close 호출해야 함
+    @param	r		request_rec. 메모리 할당, 에러 로깅
+    @param	endpoint	메세지 쌓을 SQS endpoint. e.g.) /123456789/test_sqs/
+    @param	linger_ms	메세지를 버퍼에 두는 최대 시간. 0 이하면 시간으로는 전송하지 않음
+    @param	callback	메세지 별 결과를 받을 함수. 필요없으면 NULL
+    @param	data		callback 에 전달할 값
+    @return	생성한 SQS_BATCH_T. 실패시 NULL
+*/
+SQS_BATCH_T *	tb_sqs_batch_make (request_rec * r, const char * endpoint, int linger_ms, SQS_BATCH_CALLBACK_T callback, void * data)
+{
+	if (! endpoint)
+		return	NULL ;
+
+	AWS_ASYNC_T *	async = tb_aws_async_make(r) ;
+	if (! async)
+		return	NULL ;
+
+	SQS_BATCH_T *	batch = apr_pcalloc(r->pool, sizeof(SQS_BATCH_T)) ;
+	batch->r = r ;
+	batch->async = async ;
+	batch->endpoint = apr_pstrdup(r->pool, endpoint) ;
+	batch->linger = linger_ms > 0 ? (apr_interval_time_t)linger_ms * 1000 : 0 ;
+	batch->callback = callback ;
+	batch->data = data ;
+
+	return	batch ;
+}
+
+/** @fn int	tb_sqs_batch_flush (SQS_BATCH_T * batch)
+    @brief	버퍼에 쌓인 메세지를 SendMessageBatch 로 전송 시작. 응답은 기다리지 않음
+    @param	batch	tb_sqs_batch_make 로 생성한 SQS_BATCH_T
+    @return	성공시 SUCCESS, 요청 생성 실패시 FAIL. 실패한 메세지는 callback 으로 전달됨
+*/
+int	tb_sqs_batch_flush (SQS_BATCH_T * batch)
+{
+	if (! batch)
+		return	FAIL ;
+
+	if (! batch->entries_n)
+		return	SUCCESS ;
+
+	apr_pool_t *		pool = batch->r->pool ;
+	SQS_BATCH_FLUSH_T *	flush = apr_palloc(pool, sizeof(SQS_BATCH_FLUSH_T)) ;
+	apr_array_header_t *	params = apr_array_make(pool, batch->entries_n * 2 + 1, sizeof(char *)) ;
+	int			i ;
+
+	flush->batch = batch ;
+	flush->entries_n = batch->entries_n ;
+	memcpy(flush->ids, batch->ids, sizeof(int) * batch->entries_n) ;
+
+	/* entry Id 는 batch 안의 순서 */
+	APR_ARRAY_PUSH(params, const char *) = "Action=SendMessageBatch" ;
+	for (i = 0; i < batch->entries_n; i++)
+	{
+		char	n [TB_NUMBER_BUF_SIZE] ;
+		char	index [TB_NUMBER_BUF_SIZE] ;
+		tb_ltoa(n, i + 1) ;
+		tb_ltoa(index, i) ;
+
+		APR_ARRAY_PUSH(params, const char *) = apr_pstrcat(pool, "SendMessageBatchRequestEntry.", n, ".Id=", index, NULL) ;
+		APR_ARRAY_PUSH(params, const char *) = apr_pstrcat(pool, "SendMessageBatchRequestEntry.", n, ".MessageBody=", tb_escape_url(pool, batch->bodies[i]), NULL) ;
+	}
+
+	batch->entries_n = 0 ;
+	batch->size = 0 ;
+
+	if (aws_async_submit(batch->async, AWS_SERVICE_SQS, batch->endpoint, apr_array_pstrcat(pool, params, '&'), NULL, sqs_batch_complete, flush) == FAIL)
+	{
+		for (i = 0; i < flush->entries_n; i++)
+			sqs_batch_result(batch, flush->ids[i], FAIL, "RequestFailed") ;
+		return	FAIL ;
+	}
+
+	/* 대기하지 않고 바로 전송 시작 */
+	aws_async_perform(batch->async, AWS_ASYNC_POLL) ;
+
+	return	SUCCESS ;
+}
+
+/** @fn int	tb_sqs_batch_send (SQS_BATCH_T * batch, const char * body)
+    @brief	SQS 메세지를 버퍼에 추가. 버퍼가 차거나 linger 시간이 지나면 SendMessageBatch 전송 시작.
+		전송 중인 batch 도 대기하지 않고 진행하고 끝난 batch 의 결과는 callback 으로 전달
+    @param	batch	tb_sqs_batch_make 로 생성한 SQS_BATCH_T
+    @param	body	메시지 본문. 256KB 이하
+    @return	성공시 callback 에 전달할 메세지 id (0부터 증가), 실패시 FAIL
+*/
+int	tb_sqs_batch_send (SQS_BATCH_T * batch, const char * body)
+{
+	if (!batch || !body)
+		return	FAIL ;
+
+	size_t	body_n = strlen(body) ;
+	if (body_n > SQS_BATCH_SIZE_MAX)
+		return	FAIL ;
+
+	if (batch->size + body_n > SQS_BATCH_SIZE_MAX)
+		tb_sqs_batch_flush(batch) ;
+
+	if (! batch->entries_n)
+		batch->first_time = apr_time_now() ;
+
+	int	id = batch->next_id++ ;
+	batch->bodies[batch->entries_n] = apr_pstrmemdup(batch->r->pool, body, body_n) ;
+	batch->ids[batch->entries_n] = id ;
+	batch->entries_n++ ;
+	batch->size += body_n ;
+
+	if (batch->entries_n == SQS_BATCH_ENTRY_MAX || (batch->linger && apr_time_now() - batch->first_time >= batch->linger))
+		tb_sqs_batch_flush(batch) ;
+	else if (batch->async->pending)
+	{
+		/* 전송 중인 batch 진행하고 끝난 batch 는 결과 전달, curl handle 반납 */
+		aws_async_perform(batch->async, AWS_ASYNC_POLL) ;
+	}
+
+	return	id ;
+}
+
+/** @fn int	tb_sqs_batch_close (SQS_BATCH_T * batch)
+    @brief	남은 메세지를 전송하고 모든 SendMessageBatch 응답을 기다림. 메세지 별 결과는 callback 으로 전달됨
+    @param	batch	tb_sqs_batch_make 로 생성한 SQS_BATCH_T
+    @return	모든 메세지가 성공하면 SUCCESS, 하나라도 실패하면 FAIL
+*/
+int	tb_sqs_batch_close (SQS_BATCH_T * batch)
+{
+	if (! batch)
+		return	FAIL ;
+
+	tb_sqs_batch_flush(batch) ;
+	aws_async_perform(batch->async, AWS_ASYNC_ALL) ;
+
+	return	batch->failed ? FAIL : SUCCESS ;
+}
+
 enum
 {
 	MOBILE_TYPE_IPHONE = 0,
@@ -713,26 +1871,12 @@ static	int	add_param_to_array (void * rec, const char * key, const char * value)
 #define	ALERT_TEMPLATE		"<<<alert>>>"
 #define	IPHONE_PAYLOAD_SIZE	256
 
-/** @fn int	tb_sns_push_send (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real)
-    @brief	Push 발송. IPHONE 배지 표시 가능한 함수
-    @param	r		request_rec. 메모리 할당, 에러 로깅
-    @param	mobile_type	IPHONE / ANDROID
-    @param	sns_arn		Push 발송할 endpoint ARN
-    @param	message		발송할 메세지
-    @param	badge		앱 아이콘에 표시할 배지수. IPHONE에만 해당함
-    @param	custom		기본 필드 외에 추가로 붙일 custom field table
-    @param	real		IPHONE SANDBOX 구분 위한 값. 1이면 APNS, 1이 아니면 APNS SANDBOX로 발송
-    @return	성공시 AWS_RESPONSE_T 포인터 반환, 실패시 NULL 반환
-*/
-AWS_RESPONSE_T *	tb_sns_push_send (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real)
+/* Publish 할 APNS, GCM message JSON 생성. 잘못된 mobile_type 이거나 ARN 등록 안된 경우 NULL */
+static	const char *	sns_push_data (request_rec * r, const char * mobile_type, const char * message, int badge, apr_table_t * custom, int real)
 {
-	AWS_RESPONSE_T *	response = NULL ;
-	if (!sns_arn || !mobile_type || !message)
-		return	response ;
-
 	int	type = get_mobile_type(mobile_type) ;
 	if (type == -1 || !*push_arn[type])
-		return	response ;
+		return	NULL ;
 
 	const char *	custom_add = "" ;
 	if (custom)
@@ -769,6 +1913,27 @@ AWS_RESPONSE_T *	tb_sns_push_send (request_rec * r, const char * mobile_type, co
 		data = apr_psprintf(r->pool, "{ \"GCM\":\"{\\\"data\\\":{\\\"%s\\\":\\\"%s\\\"%s%s} }\"}", key, tb_json_escaped_string(r->pool, tb_json_escaped_string(r->pool, message)), *custom_add ? ", " : "", custom_add) ;
 	}
 
+	return	data ;
+}
+
+/** @fn int	tb_sns_push_send (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real)
+    @brief	Push 발송. IPHONE 배지 표시 가능한 함수
+    @param	r		request_rec. 메모리 할당, 에러 로깅
+    @param	mobile_type	IPHONE / ANDROID
+    @param	sns_arn		Push 발송할 endpoint ARN
+    @param	message		발송할 메세지
+    @param	badge		앱 아이콘에 표시할 배지수. IPHONE에만 해당함
+    @param	custom		기본 필드 외에 추가로 붙일 custom field table
+    @param	real		IPHONE SANDBOX 구분 위한 값. 1이면 APNS, 1이 아니면 APNS SANDBOX로 발송
+    @return	성공시 AWS_RESPONSE_T 포인터 반환, 실패시 NULL 반환
+*/
+AWS_RESPONSE_T *	tb_sns_push_send (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real)
+{
+	AWS_RESPONSE_T *	response = NULL ;
+	if (!sns_arn || !mobile_type || !message)
+		return	response ;
+
+	const char *	data = sns_push_data(r, mobile_type, message, badge, custom, real) ;
 	if (! data)
 		return	response ;
 
@@ -779,6 +1944,32 @@ AWS_RESPONSE_T *	tb_sns_push_send (request_rec * r, const char * mobile_type, co
 	return	response ;
 }
 
+/** @fn int	tb_sns_push_send_async (AWS_ASYNC_T * async, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real, AWS_ASYNC_CALLBACK_T callback, void * data)
+    @brief	tb_sns_push_send 를 async 에 추가하고 바로 반환. 여러 device 에 보낼 때 tb_aws_async_wait_all 로 한 번에 전송
+    @param	async		tb_aws_async_make 로 생성한 AWS_ASYNC_T
+    @param	mobile_type	IPHONE / ANDROID
+    @param	sns_arn		Push 발송할 endpoint ARN
+    @param	message		발송할 메세지
+    @param	badge		앱 아이콘에 표시할 배지수. IPHONE에만 해당함
+    @param	custom		기본 필드 외에 추가로 붙일 custom field table
+    @param	real		IPHONE SANDBOX 구분 위한 값. 1이면 APNS, 1이 아니면 APNS SANDBOX로 발송
+    @param	callback	요청이 끝나면 호출할 함수. response->data 는 발송한 message JSON. 전송 실패시 response 는 NULL. 필요없으면 NULL
+    @param	data		callback 에 전달할 값
+    @return	성공시 request id, 실패시 FAIL
+*/
+int	tb_sns_push_send_async (AWS_ASYNC_T * async, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real, AWS_ASYNC_CALLBACK_T callback, void * data)
+{
+	if (!async || !sns_arn || !mobile_type || !message)
+		return	FAIL ;
+
+	request_rec *	r = async->r ;
+	const char *	payload = sns_push_data(r, mobile_type, message, badge, custom, real) ;
+	if (! payload)
+		return	FAIL ;
+
+	return	aws_async_submit(async, AWS_SERVICE_SNS, "/", apr_psprintf(r->pool, "Action=Publish&TargetArn=%s&Message=%s&MessageStructure=json", tb_escape_url(r->pool, sns_arn), tb_escape_url(r->pool, payload)), payload, callback, data) ;
+}
+
 /** @fn int	tb_sns_push_publish (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, apr_table_t * custom, int real)
     @brief	Push 발송
     @param	r		request_rec. 메모리 할당, 에러 로깅
@@ -875,7 +2066,10 @@ const char *	tb_cf_signer_get_url (apr_pool_t * pool, const char * base_url, tim
 			resource = apr_psprintf(pool, "http://%s", base_url) ;
 	}
 
-	const char *	canned_policy = apr_psprintf(pool, "{\"Statement\":[{\"Resource\":\"%s\",\"Condition\":{\"DateLessThan\":{\"AWS:EpochTime\":%ld}}}]}", resource, expire) ;
+	char		expire_string [TB_NUMBER_BUF_SIZE] ;
+	tb_ltoa(expire_string, expire) ;
+
+	const char *	canned_policy = apr_pstrcat(pool, "{\"Statement\":[{\"Resource\":\"", resource, "\",\"Condition\":{\"DateLessThan\":{\"AWS:EpochTime\":", expire_string, "}}}]}", NULL) ;
 	EVP_MD_CTX *	md_ctx = EVP_MD_CTX_create() ;
 	const EVP_MD *	md = EVP_sha1() ;
 	unsigned int	signature_len = EVP_PKEY_size(cf_pkey) ;
@@ -885,11 +2079,10 @@ const char *	tb_cf_signer_get_url (apr_pool_t * pool, const char * base_url, tim
 	if (!EVP_SignUpdate(md_ctx, canned_policy, strlen(canned_policy)) || !EVP_SignFinal(md_ctx, signature, &signature_len, cf_pkey))
 		return	NULL ;
 
-	char		encoded_signature[signature_len * 2 +1] ;
-	if (apr_base64_encode(encoded_signature, (const char *)signature, signature_len) <= 0)
-		return	NULL ;
+	char		encoded_signature[TB_BASE64_ENCODED_LEN(signature_len) + 1] ;
+	tb_base64_encode(encoded_signature, signature, signature_len) ;
 	cf_url_safe(encoded_signature) ;
 
-	return	apr_psprintf(pool, "%s?Expires=%ld&Signature=%s&Key-Pair-Id=%s", resource, expire, encoded_signature, cf_key_pair_id) ;
+	return	apr_pstrcat(pool, resource, "?Expires=", expire_string, "&Signature=", encoded_signature, "&Key-Pair-Id=", cf_key_pair_id, NULL) ;
 }
 
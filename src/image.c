@@ -81,3 +81,20 @@ const char *	tb_image_resize_crop (apr_pool_t * pool, const char * data, size_t
 	return	result ;
 }
 
+
+/** @fn const char *	tb_image_resize_crop_part (apr_pool_t * pool, const MULTIPART_PART_T * part, size_t * result_len, int width, int height)
+    @brief		multipart file 이미지 resize & crop. 임시 파일에 mmap 된 part 도 복사하지 않고 바로 읽음
+    @param		pool		메모리 할당 풀
+    @param		part		request_params_parse 로 파싱한 multipart file
+    @param		result_len	변환한 이미지 데이터 사이즈 반환
+    @param		width		변환할 이미지 width
+    @param		height		변환할 이미지 height
+    @return		변환한 이미지 데이터 포인터. 실패시 NULL 반환
+*/
+const char *	tb_image_resize_crop_part (apr_pool_t * pool, const MULTIPART_PART_T * part, size_t * result_len, int width, int height)
+{
+	if (! part)
+		return	NULL ;
+
+	return	tb_image_resize_crop(pool, part->data, part->data_n, result_len, width, height) ;
+}
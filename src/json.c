@@ -0,0 +1,848 @@
+//vim:ts=8
+
+/** @file json.c
+    JSON 파싱. 입력 버퍼 안에서 그대로 unescape 하고 값은 버퍼를 가리키는 node 배열(tape)로 저장
+*/
+
+#include "turbo.h"
+
+#include <math.h>
+#include <limits.h>
+
+/* 중첩 최대 깊이 */
+#define	JSON_DEPTH_MAX	512
+
+typedef struct
+{
+	apr_array_header_t *	nodes ;
+	char *			p ;
+	char *			e ;
+} JSON_PARSER_T ;
+
+static	int	json_parse_value (JSON_PARSER_T * parser, int depth) ;
+
+static	void	json_skip_space (JSON_PARSER_T * parser)
+{
+	char *	p = parser->p ;
+	while (p < parser->e && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++ ;
+	parser->p = p ;
+}
+
+static	int	json_node_add (JSON_PARSER_T * parser, int type)
+{
+	JSON_NODE_T *	node = apr_array_push(parser->nodes) ;
+	memset(node, 0, sizeof(JSON_NODE_T)) ;
+	node->type = type ;
+
+	return	parser->nodes->nelts - 1 ;
+}
+
+#define	JSON_NODE(parser, i)	(&APR_ARRAY_IDX((parser)->nodes, i, JSON_NODE_T))
+
+static	int	json_hex4 (const char * p, unsigned int * v)
+{
+	int	i ;
+	*v = 0 ;
+	for (i = 0; i < 4; i++)
+	{
+		int	c = (unsigned char)p[i] ;
+		if (! isxdigit(c))
+			return	FAIL ;
+		*v = *v << 4 | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10) ;
+	}
+
+	return	SUCCESS ;
+}
+
+/* 문자열을 그 자리에서 unescape. parser->p 는 여는 따옴표 다음 위치. 닫는 따옴표 다음으로 이동 */
+static	int	json_parse_string (JSON_PARSER_T * parser, const char ** str, size_t * str_n)
+{
+	char *	p = parser->p ;
+	char *	e = parser->e ;
+
+	/* escape 없는 앞부분은 이동하지 않음 */
+	while (p < e && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+		p++ ;
+
+	char *	d = p ;
+	while (p < e && *p != '"')
+	{
+		unsigned char	c = *p++ ;
+		if (c < 0x20)
+			return	FAIL ;
+
+		if (c != '\\')
+		{
+			*d++ = c ;
+			continue ;
+		}
+
+		if (p >= e)
+			return	FAIL ;
+
+		switch (*p++)
+		{
+			case '"' :	*d++ = '"' ;	break ;
+			case '\\' :	*d++ = '\\' ;	break ;
+			case '/' :	*d++ = '/' ;	break ;
+			case 'b' :	*d++ = '\b' ;	break ;
+			case 'f' :	*d++ = '\f' ;	break ;
+			case 'n' :	*d++ = '\n' ;	break ;
+			case 'r' :	*d++ = '\r' ;	break ;
+			case 't' :	*d++ = '\t' ;	break ;
+			case 'u' :
+			{
+				unsigned int	u ;
+				if (e - p < 4 || json_hex4(p, &u) != SUCCESS)
+					return	FAIL ;
+				p += 4 ;
+
+				/* surrogate pair */
+				if (u >= 0xd800 && u <= 0xdbff)
+				{
+					unsigned int	low ;
+					if (e - p < 6 || p[0] != '\\' || p[1] != 'u' || json_hex4(p + 2, &low) != SUCCESS || low < 0xdc00 || low > 0xdfff)
+						return	FAIL ;
+					p += 6 ;
+					u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00) ;
+				}
+				else if (u >= 0xdc00 && u <= 0xdfff)
+					return	FAIL ;
+
+				/* UTF-8 은 \uXXXX 6자 보다 짧으므로 그 자리에 써도 됨 */
+				if (u < 0x80)
+					*d++ = u ;
+				else if (u < 0x800)
+				{
+					*d++ = 0xc0 | u >> 6 ;
+					*d++ = 0x80 | (u & 0x3f) ;
+				}
+				else if (u < 0x10000)
+				{
+					*d++ = 0xe0 | u >> 12 ;
+					*d++ = 0x80 | (u >> 6 & 0x3f) ;
+					*d++ = 0x80 | (u & 0x3f) ;
+				}
+				else
+				{
+					*d++ = 0xf0 | u >> 18 ;
+					*d++ = 0x80 | (u >> 12 & 0x3f) ;
+					*d++ = 0x80 | (u >> 6 & 0x3f) ;
+					*d++ = 0x80 | (u & 0x3f) ;
+				}
+				break ;
+			}
+			default :
+				return	FAIL ;
+		}
+	}
+
+	if (p >= e)
+		return	FAIL ;
+
+	*str = parser->p ;
+	*str_n = d - parser->p ;
+	parser->p = p + 1 ;
+
+	return	SUCCESS ;
+}
+
+static	int	json_parse_number (JSON_PARSER_T * parser, int node)
+{
+	char *	s = parser->p ;
+	char *	p = s ;
+	char *	e = parser->e ;
+
+	if (p < e && *p == '-')
+		p++ ;
+
+	if (p < e && *p == '0')
+		p++ ;
+	else if (p < e && isdigit(*p))
+		while (p < e && isdigit(*p))
+			p++ ;
+	else
+		return	FAIL ;
+
+	if (p < e && *p == '.')
+	{
+		if (++p >= e || !isdigit(*p))
+			return	FAIL ;
+		while (p < e && isdigit(*p))
+			p++ ;
+	}
+
+	if (p < e && (*p == 'e' || *p == 'E'))
+	{
+		p++ ;
+		if (p < e && (*p == '+' || *p == '-'))
+			p++ ;
+		if (p >= e || !isdigit(*p))
+			return	FAIL ;
+		while (p < e && isdigit(*p))
+			p++ ;
+	}
+
+	JSON_NODE(parser, node)->value = s ;
+	JSON_NODE(parser, node)->value_n = p - s ;
+	parser->p = p ;
+
+	return	SUCCESS ;
+}
+
+static	int	json_parse_literal (JSON_PARSER_T * parser, const char * literal, size_t literal_n, int type)
+{
+	if (parser->e - parser->p < literal_n || memcmp(parser->p, literal, literal_n))
+		return	FAIL ;
+
+	int	node = json_node_add(parser, type) ;
+	JSON_NODE(parser, node)->value = literal ;
+	JSON_NODE(parser, node)->value_n = literal_n ;
+	parser->p += literal_n ;
+
+	return	SUCCESS ;
+}
+
+/* array, object. 자식 node 는 바로 뒤에 이어지고 next 로 형제 node 를 연결 */
+static	int	json_parse_container (JSON_PARSER_T * parser, int depth, int object)
+{
+	char	close = object ? '}' : ']' ;
+	int	node = json_node_add(parser, object ? JSON_OBJECT : JSON_ARRAY) ;
+	int	prev = 0 ;
+
+	if (depth >= JSON_DEPTH_MAX)
+		return	FAIL ;
+
+	parser->p++ ;
+	json_skip_space(parser) ;
+	if (parser->p < parser->e && *parser->p == close)
+	{
+		parser->p++ ;
+		return	SUCCESS ;
+	}
+
+	for (;;)
+	{
+		const char *	key = NULL ;
+		size_t		key_n = 0 ;
+
+		if (object)
+		{
+			if (parser->p >= parser->e || *parser->p != '"')
+				return	FAIL ;
+			parser->p++ ;
+			if (json_parse_string(parser, &key, &key_n) != SUCCESS)
+				return	FAIL ;
+
+			json_skip_space(parser) ;
+			if (parser->p >= parser->e || *parser->p != ':')
+				return	FAIL ;
+			parser->p++ ;
+			json_skip_space(parser) ;
+		}
+
+		int	child = parser->nodes->nelts ;
+		if (json_parse_value(parser, depth + 1) != SUCCESS)
+			return	FAIL ;
+
+		JSON_NODE(parser, child)->key = key ;
+		JSON_NODE(parser, child)->key_n = key_n ;
+		if (prev)
+			JSON_NODE(parser, prev)->next = child ;
+		prev = child ;
+		JSON_NODE(parser, node)->children_n++ ;
+
+		json_skip_space(parser) ;
+		if (parser->p >= parser->e)
+			return	FAIL ;
+
+		if (*parser->p == ',')
+		{
+			parser->p++ ;
+			json_skip_space(parser) ;
+			continue ;
+		}
+
+		if (*parser->p++ != close)
+			return	FAIL ;
+
+		return	SUCCESS ;
+	}
+}
+
+static	int	json_parse_value (JSON_PARSER_T * parser, int depth)
+{
+	if (parser->p >= parser->e)
+		return	FAIL ;
+
+	switch (*parser->p)
+	{
+		case '{' :	return	json_parse_container(parser, depth, 1) ;
+		case '[' :	return	json_parse_container(parser, depth, 0) ;
+		case 't' :	return	json_parse_literal(parser, "true", 4, JSON_TRUE) ;
+		case 'f' :	return	json_parse_literal(parser, "false", 5, JSON_FALSE) ;
+		case 'n' :	return	json_parse_literal(parser, "null", 4, JSON_NULL) ;
+		case '"' :
+		{
+			int	node = json_node_add(parser, JSON_STRING) ;
+			parser->p++ ;
+			return	json_parse_string(parser, &JSON_NODE(parser, node)->value, &JSON_NODE(parser, node)->value_n) ;
+		}
+		default :
+			return	json_parse_number(parser, json_node_add(parser, JSON_NUMBER)) ;
+	}
+}
+
+/** @fn JSON_T *	tb_json_parse (apr_pool_t * pool, char * buf, size_t len)
+    @brief	JSON 파싱. token 별로 메모리 할당하지 않고 buf 안에서 그대로 unescape 하며 node 는 buf 를 가리킴
+    @param	pool	메모리 할당 풀. node 배열 할당
+    @param	buf	JSON 문자열. 파싱하면서 내용이 바뀌며 len + 1 byte 크기여야 함
+    @param	len	buf 의 길이
+    @return	파싱 결과. 형식이 잘못된 경우 NULL 반환
+*/
+JSON_T *	tb_json_parse (apr_pool_t * pool, char * buf, size_t len)
+{
+	if (! buf)
+		return	NULL ;
+
+	JSON_PARSER_T	parser = {
+		.nodes = apr_array_make(pool, len / 16 + 4, sizeof(JSON_NODE_T)),
+		.p = buf,
+		.e = buf + len,
+	} ;
+
+	json_skip_space(&parser) ;
+	if (json_parse_value(&parser, 0) != SUCCESS)
+		return	NULL ;
+
+	json_skip_space(&parser) ;
+	if (parser.p != parser.e)
+		return	NULL ;
+
+	/* 파싱 끝난 후에 문자열, 숫자 뒤에 NULL 문자 넣기. 파싱 중에 넣으면 다음 token 을 덮어씀 */
+	JSON_T *	json = apr_palloc(pool, sizeof(JSON_T)) ;
+	json->nodes = (JSON_NODE_T *)parser.nodes->elts ;
+	json->nodes_n = parser.nodes->nelts ;
+
+	int	i ;
+	for (i = 0; i < json->nodes_n; i++)
+	{
+		JSON_NODE_T *	node = &json->nodes[i] ;
+		if (node->key)
+			((char *)node->key)[node->key_n] = '\0' ;
+		if (node->type == JSON_STRING || node->type == JSON_NUMBER)
+			((char *)node->value)[node->value_n] = '\0' ;
+	}
+
+	return	json ;
+}
+
+/** @fn const JSON_NODE_T *	tb_json_root (const JSON_T * json)
+    @brief	최상위 node
+    @param	json	tb_json_parse 결과
+    @return	최상위 node. json 이 NULL 이면 NULL 반환
+*/
+const JSON_NODE_T *	tb_json_root (const JSON_T * json)
+{
+	return	json && json->nodes_n ? json->nodes : NULL ;
+}
+
+/** @fn const JSON_NODE_T *	tb_json_child (const JSON_T * json, const JSON_NODE_T * node)
+    @brief	array, object 의 첫번째 자식 node
+    @param	json	tb_json_parse 결과
+    @param	node	array, object node
+    @return	첫번째 자식 node. 없으면 NULL 반환
+*/
+const JSON_NODE_T *	tb_json_child (const JSON_T * json, const JSON_NODE_T * node)
+{
+	if (!node || (node->type != JSON_ARRAY && node->type != JSON_OBJECT) || !node->children_n)
+		return	NULL ;
+
+	return	node + 1 ;
+}
+
+/** @fn const JSON_NODE_T *	tb_json_next (const JSON_T * json, const JSON_NODE_T * node)
+    @brief	다음 형제 node
+    @param	json	tb_json_parse 결과
+    @param	node	node
+    @return	다음 형제 node. 마지막 node 면 NULL 반환
+*/
+const JSON_NODE_T *	tb_json_next (const JSON_T * json, const JSON_NODE_T * node)
+{
+	return	json && node && node->next ? json->nodes + node->next : NULL ;
+}
+
+/** @fn const JSON_NODE_T *	tb_json_get (const JSON_T * json, const JSON_NODE_T * node, const char * key)
+    @brief	object 에서 key 로 값 찾기
+    @param	json	tb_json_parse 결과
+    @param	node	object node. NULL 이면 최상위 node
+    @param	key	찾을 key
+    @return	값 node. 없으면 NULL 반환
+*/
+const JSON_NODE_T *	tb_json_get (const JSON_T * json, const JSON_NODE_T * node, const char * key)
+{
+	if (! node)
+		node = tb_json_root(json) ;
+	if (!node || node->type != JSON_OBJECT || !key)
+		return	NULL ;
+
+	const JSON_NODE_T *	child ;
+	for (child = tb_json_child(json, node); child; child = tb_json_next(json, child))
+	{
+		if (! strcmp(child->key, key))
+			return	child ;
+	}
+
+	return	NULL ;
+}
+
+/** @fn const JSON_NODE_T *	tb_json_at (const JSON_T * json, const JSON_NODE_T * node, int index)
+    @brief	array 에서 index 번째 값 찾기
+    @param	json	tb_json_parse 결과
+    @param	node	array node. NULL 이면 최상위 node
+    @param	index	0부터 시작
+    @return	값 node. 없으면 NULL 반환
+*/
+const JSON_NODE_T *	tb_json_at (const JSON_T * json, const JSON_NODE_T * node, int index)
+{
+	if (! node)
+		node = tb_json_root(json) ;
+	if (!node || node->type != JSON_ARRAY || index < 0 || index >= node->children_n)
+		return	NULL ;
+
+	const JSON_NODE_T *	child = tb_json_child(json, node) ;
+	while (child && index--)
+		child = tb_json_next(json, child) ;
+
+	return	child ;
+}
+
+/** @fn const char *	tb_json_string (const JSON_NODE_T * node, const char * def)
+    @brief	node 값을 문자열로 읽기. 숫자, true, false 도 문자열로 반환
+    @param	node	node
+    @param	def	기본값
+    @return	문자열. node 가 없거나 null, array, object 인 경우 def
+*/
+const char *	tb_json_string (const JSON_NODE_T * node, const char * def)
+{
+	if (!node || node->type == JSON_NULL || node->type == JSON_ARRAY || node->type == JSON_OBJECT)
+		return	def ;
+
+	return	node->value ;
+}
+
+/** @fn long	tb_json_integer (const JSON_NODE_T * node, long def)
+    @brief	node 값을 정수로 읽기
+    @param	node	node
+    @param	def	기본값
+    @return	정수 값. 숫자나 숫자 문자열이 아닌 경우 def
+*/
+long	tb_json_integer (const JSON_NODE_T * node, long def)
+{
+	if (!node || (node->type != JSON_NUMBER && node->type != JSON_STRING))
+		return	def ;
+
+	long	value ;
+	if (tb_parse_long(node->value, node->value_n, &value) == SUCCESS)
+		return	value ;
+
+	/* 1.0, 1e3 같은 실수 형식은 범위 안이면 소수점 아래를 버림 */
+	double	d ;
+	if (tb_parse_double(node->value, node->value_n, &d) == SUCCESS && d > (double)LONG_MIN && d < (double)LONG_MAX)
+		return	(long)d ;
+
+	return	def ;
+}
+
+/** @fn double	tb_json_double (const JSON_NODE_T * node, double def)
+    @brief	node 값을 실수로 읽기
+    @param	node	node
+    @param	def	기본값
+    @return	실수 값. 숫자나 숫자 문자열이 아닌 경우 def
+*/
+double	tb_json_double (const JSON_NODE_T * node, double def)
+{
+	if (!node || (node->type != JSON_NUMBER && node->type != JSON_STRING))
+		return	def ;
+
+	double	value ;
+	if (tb_parse_double(node->value, node->value_n, &value) == SUCCESS)
+		return	value ;
+
+	return	def ;
+}
+
+/** @fn int	tb_json_boolean (const JSON_NODE_T * node, int def)
+    @brief	node 값을 boolean 으로 읽기
+    @param	node	node
+    @param	def	기본값
+    @return	true 면 1, false 면 0. boolean 이 아닌 경우 def
+*/
+int	tb_json_boolean (const JSON_NODE_T * node, int def)
+{
+	if (! node)
+		return	def ;
+
+	if (node->type == JSON_TRUE)
+		return	1 ;
+	if (node->type == JSON_FALSE)
+		return	0 ;
+
+	return	def ;
+}
+
+struct	JSON_WRITER_T
+{
+	apr_pool_t *	pool ;
+	char *		buf ;
+	size_t		buf_n ;
+	size_t		buf_size ;
+	int		comma ;		/* 다음 값 앞에 ',' 필요 여부 */
+
+	request_rec *		r ;	/* output filter 로 보내는 경우 */
+	apr_bucket_brigade *	bb ;
+	int			failed ;
+} ;
+
+/* 버퍼 내용을 output filter 로 보내고 버퍼 비우기. 버퍼를 재사용하므로 flush bucket 을 붙여서 바로 전송 */
+static	int	json_writer_pass (JSON_WRITER_T * writer)
+{
+	if (!writer->buf_n || writer->failed)
+	{
+		writer->buf_n = 0 ;
+		return	writer->failed ? FAIL : SUCCESS ;
+	}
+
+	apr_bucket_alloc_t *	bucket_alloc = writer->r->connection->bucket_alloc ;
+	APR_BRIGADE_INSERT_TAIL(writer->bb, apr_bucket_transient_create(writer->buf, writer->buf_n, bucket_alloc)) ;
+	APR_BRIGADE_INSERT_TAIL(writer->bb, apr_bucket_flush_create(bucket_alloc)) ;
+
+	apr_status_t	rv = ap_pass_brigade(writer->r->output_filters, writer->bb) ;
+	apr_brigade_cleanup(writer->bb) ;
+	writer->buf_n = 0 ;
+
+	/* client 연결이 끊긴 경우 이후 출력은 버림 */
+	if (rv != APR_SUCCESS)
+	{
+		TB_LOG_WARN(writer->r, "%s: ap_pass_brigade failed [%d].", __FUNCTION__, rv) ;
+		writer->failed = 1 ;
+		return	FAIL ;
+	}
+
+	return	SUCCESS ;
+}
+
+/* buf 에 n byte 더 쓸 공간 확보. 두 배씩 늘리고 끝에 NULL 문자 넣을 공간을 남겨둠.
+   output filter 로 보내는 writer 는 버퍼가 차면 먼저 보내고 버퍼를 재사용함 */
+static	char *	json_writer_reserve (JSON_WRITER_T * writer, size_t n)
+{
+	if (writer->buf_n + n + 1 > writer->buf_size)
+	{
+		if (writer->r && writer->buf_n)
+		{
+			json_writer_pass(writer) ;
+			if (n + 1 <= writer->buf_size)
+				return	writer->buf ;
+		}
+
+		size_t	size = writer->buf_size * 2 ;
+		if (size < writer->buf_n + n + 1)
+			size = writer->buf_n + n + 1 ;
+
+		char *	buf = apr_palloc(writer->pool, size) ;
+		memcpy(buf, writer->buf, writer->buf_n) ;
+		writer->buf = buf ;
+		writer->buf_size = size ;
+	}
+
+	return	writer->buf + writer->buf_n ;
+}
+
+static	void	json_writer_append (JSON_WRITER_T * writer, const char * str, size_t len)
+{
+	memcpy(json_writer_reserve(writer, len), str, len) ;
+	writer->buf_n += len ;
+}
+
+/* 값이나 key 앞에 ',' 넣기 */
+static	void	json_writer_separate (JSON_WRITER_T * writer)
+{
+	if (writer->comma)
+		json_writer_append(writer, ",", 1) ;
+	writer->comma = 1 ;
+}
+
+/* escape 하면서 double quote 로 감싸기. escape 할 문자가 없으면 버퍼 확보는 한 번만 함.
+   escape 할 문자를 만났을 때 남은 문자열을 최대 길이로 escape 해도 버퍼에 들어가면 나머지를 한 번에 쓰고,
+   아니면 버퍼를 키우지 않도록 escape 할 때마다 그 문자의 최대 길이와 남은 문자열만큼 다시 확보함 */
+static	void	json_writer_quote (JSON_WRITER_T * writer, const char * str, size_t len)
+{
+	const char *	e = str + len ;
+	char *		d = json_writer_reserve(writer, len + 2) ;
+
+	*d++ = '"' ;
+	for (;;)
+	{
+		const char *	p = tb_escape_json_find(str, e) ;
+
+		memcpy(d, str, p - str) ;
+		d += p - str ;
+		if (p == e)
+			break ;
+
+		writer->buf_n = d - writer->buf ;
+		if (writer->buf_n + (e - p) * 6 + 2 <= writer->buf_size)
+		{
+			d = tb_escape_json_buffer(d, p, e - p) ;
+			break ;
+		}
+
+		/* escape 6자 + 남은 문자열 + 닫는 double quote */
+		d = json_writer_reserve(writer, (e - p) + 6) ;
+		d = tb_escape_json_buffer(d, p, 1) ;
+		str = p + 1 ;
+	}
+	*d++ = '"' ;
+
+	writer->buf_n = d - writer->buf ;
+}
+
+/** @fn JSON_WRITER_T *	tb_json_writer_make (apr_pool_t * pool, size_t size)
+    @brief	JSON writer 생성. 한 버퍼에 이어서 쓰고 버퍼가 부족하면 두 배씩 늘림. ',' 는 writer 가 넣음
+    @param	pool	메모리 할당 풀
+    @param	size	처음 버퍼 크기. 0 이면 기본값 사용
+    @return	생성한 writer
+*/
+JSON_WRITER_T *	tb_json_writer_make (apr_pool_t * pool, size_t size)
+{
+	JSON_WRITER_T *	writer = apr_pcalloc(pool, sizeof(JSON_WRITER_T)) ;
+	writer->pool = pool ;
+	writer->buf_size = size ? : HUGE_STRING_LEN ;
+	writer->buf = apr_palloc(pool, writer->buf_size) ;
+
+	return	writer ;
+}
+
+/** @fn JSON_WRITER_T *	tb_json_writer_make_output (request_rec * r, size_t chunk_size)
+    @brief	output filter 로 바로 출력하는 JSON writer 생성. chunk_size 만큼 쌓이면 전송하고 버퍼를 재사용하므로
+		응답 크기와 관계없이 메모리 사용량이 일정하고 첫 byte 를 빨리 보냄. 다 쓴 후에 tb_json_writer_flush 호출해야 함
+    @param	r		request_rec. Content-Type 등 header 는 먼저 설정해야 함
+    @param	chunk_size	한 번에 전송할 크기. 0 이면 기본값 사용
+    @return	생성한 writer
+*/
+JSON_WRITER_T *	tb_json_writer_make_output (request_rec * r, size_t chunk_size)
+{
+	JSON_WRITER_T *	writer = tb_json_writer_make(r->pool, chunk_size) ;
+	writer->r = r ;
+	writer->bb = apr_brigade_create(r->pool, r->connection->bucket_alloc) ;
+
+	return	writer ;
+}
+
+/** @fn int	tb_json_writer_flush (JSON_WRITER_T * writer)
+    @brief	tb_json_writer_make_output 으로 만든 writer 에 남은 내용을 전송. 메모리에 쓰는 writer 는 아무것도 하지 않음
+    @param	writer	JSON writer
+    @return	성공시 SUCCESS, 전송 실패한 적이 있으면 FAIL
+*/
+int	tb_json_writer_flush (JSON_WRITER_T * writer)
+{
+	if (! writer->r)
+		return	SUCCESS ;
+
+	return	json_writer_pass(writer) ;
+}
+
+/** @fn void	tb_json_writer_text (JSON_WRITER_T * writer, const char * text, size_t len)
+    @brief	문자열을 escape 하지 않고 ',' 도 넣지 않고 그대로 출력. JSONP callback 이름이나 JSON 이 아닌 text 응답에 사용
+    @param	writer	JSON writer
+    @param	text	출력할 문자열
+    @param	len	문자열 길이
+*/
+void	tb_json_writer_text (JSON_WRITER_T * writer, const char * text, size_t len)
+{
+	json_writer_append(writer, text, len) ;
+}
+
+/** @fn void	tb_json_writer_begin_object (JSON_WRITER_T * writer)
+    @brief	object 시작. '{' 출력
+    @param	writer	JSON writer
+*/
+void	tb_json_writer_begin_object (JSON_WRITER_T * writer)
+{
+	json_writer_separate(writer) ;
+	json_writer_append(writer, "{", 1) ;
+	writer->comma = 0 ;
+}
+
+/** @fn void	tb_json_writer_end_object (JSON_WRITER_T * writer)
+    @brief	object 끝. '}' 출력
+    @param	writer	JSON writer
+*/
+void	tb_json_writer_end_object (JSON_WRITER_T * writer)
+{
+	json_writer_append(writer, "}", 1) ;
+	writer->comma = 1 ;
+}
+
+/** @fn void	tb_json_writer_begin_array (JSON_WRITER_T * writer)
+    @brief	array 시작. '[' 출력
+    @param	writer	JSON writer
+*/
+void	tb_json_writer_begin_array (JSON_WRITER_T * writer)
+{
+	json_writer_separate(writer) ;
+	json_writer_append(writer, "[", 1) ;
+	writer->comma = 0 ;
+}
+
+/** @fn void	tb_json_writer_end_array (JSON_WRITER_T * writer)
+    @brief	array 끝. ']' 출력
+    @param	writer	JSON writer
+*/
+void	tb_json_writer_end_array (JSON_WRITER_T * writer)
+{
+	json_writer_append(writer, "]", 1) ;
+	writer->comma = 1 ;
+}
+
+/** @fn void	tb_json_writer_key (JSON_WRITER_T * writer, const char * key)
+    @brief	object 의 key 출력. 다음에 쓰는 값이 key 의 값이 됨
+    @param	writer	JSON writer
+    @param	key	key. escape 처리함
+*/
+void	tb_json_writer_key (JSON_WRITER_T * writer, const char * key)
+{
+	json_writer_separate(writer) ;
+	json_writer_quote(writer, key, strlen(key)) ;
+	json_writer_append(writer, ":", 1) ;
+	writer->comma = 0 ;
+}
+
+/** @fn void	tb_json_writer_string (JSON_WRITER_T * writer, const char * str)
+    @brief	문자열 값 출력. escape 처리하고 double quote 로 감쌈
+    @param	writer	JSON writer
+    @param	str	문자열. NULL 이면 null 출력
+*/
+void	tb_json_writer_string (JSON_WRITER_T * writer, const char * str)
+{
+	if (str)
+		tb_json_writer_string_n(writer, str, strlen(str)) ;
+	else
+		tb_json_writer_null(writer) ;
+}
+
+/** @fn void	tb_json_writer_string_n (JSON_WRITER_T * writer, const char * str, size_t len)
+    @brief	길이를 지정한 문자열 값 출력. escape 처리하고 double quote 로 감쌈
+    @param	writer	JSON writer
+    @param	str	문자열
+    @param	len	문자열 길이
+*/
+void	tb_json_writer_string_n (JSON_WRITER_T * writer, const char * str, size_t len)
+{
+	json_writer_separate(writer) ;
+	json_writer_quote(writer, str, len) ;
+}
+
+/** @fn void	tb_json_writer_integer (JSON_WRITER_T * writer, long value)
+    @brief	정수 값 출력
+    @param	writer	JSON writer
+    @param	value	값
+*/
+void	tb_json_writer_integer (JSON_WRITER_T * writer, long value)
+{
+	json_writer_separate(writer) ;
+
+	char *	d = json_writer_reserve(writer, TB_NUMBER_BUF_SIZE) ;
+	writer->buf_n += tb_ltoa(d, value) - d ;
+}
+
+/** @fn void	tb_json_writer_double (JSON_WRITER_T * writer, double value)
+    @brief	실수 값 출력. 다시 읽었을 때 같은 값이 되는 가장 짧은 문자열로 출력하고 NaN, Infinity 는 JSON 에 없으므로 null 출력
+    @param	writer	JSON writer
+    @param	value	값
+*/
+void	tb_json_writer_double (JSON_WRITER_T * writer, double value)
+{
+	if (! isfinite(value))
+	{
+		tb_json_writer_null(writer) ;
+		return ;
+	}
+
+	json_writer_separate(writer) ;
+
+	char *	d = json_writer_reserve(writer, TB_NUMBER_BUF_SIZE) ;
+	writer->buf_n += tb_dtoa(d, value) - d ;
+}
+
+/** @fn void	tb_json_writer_double_fixed (JSON_WRITER_T * writer, double value, int precision)
+    @brief	실수 값을 소수점 아래 precision 자리로 반올림해서 출력. NaN, Infinity 는 null 출력
+    @param	writer		JSON writer
+    @param	value		값
+    @param	precision	소수점 아래 자릿수. tb_dtoa_fixed 참고
+*/
+void	tb_json_writer_double_fixed (JSON_WRITER_T * writer, double value, int precision)
+{
+	if (! isfinite(value))
+	{
+		tb_json_writer_null(writer) ;
+		return ;
+	}
+
+	json_writer_separate(writer) ;
+
+	char *	d = json_writer_reserve(writer, TB_NUMBER_BUF_SIZE) ;
+	writer->buf_n += tb_dtoa_fixed(d, value, precision) - d ;
+}
+
+/** @fn void	tb_json_writer_boolean (JSON_WRITER_T * writer, int value)
+    @brief	boolean 값 출력
+    @param	writer	JSON writer
+    @param	value	0 이 아니면 true, 0 이면 false
+*/
+void	tb_json_writer_boolean (JSON_WRITER_T * writer, int value)
+{
+	json_writer_separate(writer) ;
+	if (value)
+		json_writer_append(writer, "true", 4) ;
+	else
+		json_writer_append(writer, "false", 5) ;
+}
+
+/** @fn void	tb_json_writer_null (JSON_WRITER_T * writer)
+    @brief	null 출력
+    @param	writer	JSON writer
+*/
+void	tb_json_writer_null (JSON_WRITER_T * writer)
+{
+	json_writer_separate(writer) ;
+	json_writer_append(writer, "null", 4) ;
+}
+
+/** @fn void	tb_json_writer_raw (JSON_WRITER_T * writer, const char * json)
+    @brief	이미 만들어진 JSON 값을 그대로 출력. tb_key_value_json_* 같은 기존 함수 결과를 넣을 때 사용
+    @param	writer	JSON writer
+    @param	json	JSON 값. NULL 이면 null 출력
+*/
+void	tb_json_writer_raw (JSON_WRITER_T * writer, const char * json)
+{
+	json_writer_separate(writer) ;
+	json_writer_append(writer, json ? : "null", json ? strlen(json) : 4) ;
+}
+
+/** @fn const char *	tb_json_writer_result (JSON_WRITER_T * writer, size_t * len)
+    @brief	지금까지 쓴 JSON 문자열. 복사하지 않고 writer 의 버퍼를 반환하며 계속 이어서 쓸 수 있음.
+		output filter 로 보내는 writer 는 아직 보내지 않은 부분만 반환
+    @param	writer	JSON writer
+    @param	len	JSON 문자열 길이 저장. NULL 이면 저장하지 않음
+    @return	NULL 종료된 JSON 문자열
+*/
+const char *	tb_json_writer_result (JSON_WRITER_T * writer, size_t * len)
+{
+	writer->buf[writer->buf_n] = '\0' ;
+	if (len)
+		*len = writer->buf_n ;
+
+	return	writer->buf ;
+}
@@ -0,0 +1,447 @@
+//vim:ts=8
+
+/** @file multipart.c
+    multipart/form-data streaming parser. body 전체를 버퍼링하지 않고 chunk 단위로 입력받아 part 별로 callback 호출
+*/
+
+#include "turbo.h"
+
+/* RFC 2046: boundary 는 최대 70자 */
+#define	MULTIPART_BOUNDARY_MAX	70
+
+enum
+{
+	MULTIPART_STATE_PREAMBLE = 0,
+	MULTIPART_STATE_BOUNDARY,
+	MULTIPART_STATE_BOUNDARY_CR,
+	MULTIPART_STATE_BOUNDARY_DASH,
+	MULTIPART_STATE_HEADER,
+	MULTIPART_STATE_DATA,
+	MULTIPART_STATE_END,
+	MULTIPART_STATE_ERROR,
+} ;
+
+struct	MULTIPART_PARSER_T
+{
+	apr_pool_t *			pool ;
+	const MULTIPART_CALLBACK_T *	callback ;
+	void *				data ;
+
+	int			state ;
+	char			delimiter [MULTIPART_BOUNDARY_MAX + 5] ;	/* "\r\n--" + boundary */
+	size_t			delimiter_n ;
+	MEMSEARCH_T		search ;	/* delimiter 탐색기 */
+	size_t			match ;		/* 이전 chunk 끝에서 부분 매칭된 delimiter 길이 */
+	apr_off_t		offset ;	/* 지금까지 입력받은 byte 수 */
+
+	char			header [MULTIPART_HEADER_MAX] ;
+	size_t			header_n ;
+
+	MULTIPART_PART_T *	part ;
+
+	int			digests ;	/* 진행중인 part 에 대해 계산중인 digest */
+	DIGEST_T *		md5 ;		/* part 마다 reset 해서 재사용 */
+	DIGEST_T *		sha256 ;
+} ;
+
+/** @fn const char *	tb_multipart_boundary (apr_pool_t * pool, const char * content_type)
+    @brief	Content-Type 헤더에서 multipart boundary 읽기
+    @param	pool		메모리 할당 풀
+    @param	content_type	Content-Type 헤더 값. e.g.) multipart/form-data; boundary=----WebKitFormBoundarybkPVQ2XhzZ75QktL
+    @return	boundary 문자열. 없거나 잘못된 경우 NULL 반환
+*/
+const char *	tb_multipart_boundary (apr_pool_t * pool, const char * content_type)
+{
+	if (! content_type)
+		return	NULL ;
+
+	const char *	p = strstr(content_type, "boundary=") ;
+	if (! p)
+		return	NULL ;
+
+	p += 9 ;
+
+	const char *	e ;
+	if (*p == '"')
+	{
+		e = strchr(++p, '"') ;
+		if (! e)
+			return	NULL ;
+	}
+	else
+	{
+		e = p ;
+		while (*e && *e != ';' && *e != ' ' && *e != '\t' && *e != '\r' && *e != '\n')
+			e++ ;
+	}
+
+	if (e == p || e - p > MULTIPART_BOUNDARY_MAX)
+		return	NULL ;
+
+	return	apr_pstrmemdup(pool, p, e - p) ;
+}
+
+/** @fn MULTIPART_PARSER_T *	tb_multipart_parser_create (apr_pool_t * pool, const char * boundary, const MULTIPART_CALLBACK_T * callback, void * data)
+    @brief	multipart streaming parser 생성
+    @param	pool		메모리 할당 풀. part 정보도 이 풀에 할당됨
+    @param	boundary	multipart boundary. tb_multipart_boundary 로 읽은 값
+    @param	callback	part 별로 호출할 callback 목록. 필요 없는 callback 은 NULL 로 둬도 됨
+    @param	data		callback 에 전달할 사용자 데이터
+    @return	생성한 parser. boundary 가 잘못된 경우 NULL 반환
+*/
+MULTIPART_PARSER_T *	tb_multipart_parser_create (apr_pool_t * pool, const char * boundary, const MULTIPART_CALLBACK_T * callback, void * data)
+{
+	size_t	boundary_n = boundary ? strlen(boundary) : 0 ;
+	if (!boundary_n || boundary_n > MULTIPART_BOUNDARY_MAX || !callback)
+		return	NULL ;
+
+	MULTIPART_PARSER_T *	parser = apr_pcalloc(pool, sizeof(MULTIPART_PARSER_T)) ;
+	parser->pool = pool ;
+	parser->callback = callback ;
+	parser->data = data ;
+	parser->state = MULTIPART_STATE_PREAMBLE ;
+
+	memcpy(parser->delimiter, "\r\n--", 4) ;
+	memcpy(parser->delimiter + 4, boundary, boundary_n + 1) ;
+	parser->delimiter_n = boundary_n + 4 ;
+	tb_memsearch_init(&parser->search, parser->delimiter, parser->delimiter_n) ;
+
+	/* body 가 preamble 없이 바로 "--boundary" 로 시작하는 경우를 위해 "\r\n" 은 이미 매칭된 것으로 처리 */
+	parser->match = 2 ;
+
+	return	parser ;
+}
+
+/* Content-Disposition 헤더에서 name, filename 같은 parameter 값 읽기 */
+static	const char *	disposition_param (apr_pool_t * pool, const char * value, const char * param)
+{
+	size_t		param_n = strlen(param) ;
+	const char *	p = value ;
+
+	while ((p = strchr(p, ';')))
+	{
+		p++ ;
+		while (*p == ' ' || *p == '\t')
+			p++ ;
+
+		if (strncasecmp(p, param, param_n) || p[param_n] != '=')
+			continue ;
+
+		p += param_n + 1 ;
+
+		const char *	e ;
+		if (*p == '"')
+		{
+			e = ++p ;
+			while (*e && *e != '"')
+			{
+				if (*e == '\\' && e[1])
+					e++ ;
+				e++ ;
+			}
+		}
+		else
+		{
+			e = p ;
+			while (*e && *e != ';' && *e != ' ' && *e != '\t')
+				e++ ;
+		}
+
+		return	apr_pstrmemdup(pool, p, e - p) ;
+	}
+
+	return	NULL ;
+}
+
+/* header 한 줄 파싱. Content-Disposition, Content-Type 은 part 에도 따로 저장 */
+static	int	multipart_parse_header (MULTIPART_PARSER_T * parser)
+{
+	MULTIPART_PART_T *	part = parser->part ;
+	char *			line = parser->header ;
+	char *			e = line + parser->header_n ;
+
+	if (e > line && e[-1] == '\r')
+		e-- ;
+	*e = '\0' ;
+
+	char *	value = strchr(line, ':') ;
+	if (! value)
+		return	FAIL ;
+
+	*value++ = '\0' ;
+	while (*value == ' ' || *value == '\t')
+		value++ ;
+
+	const char *	name = apr_pstrdup(parser->pool, line) ;
+	value = apr_pstrdup(parser->pool, value) ;
+	apr_table_addn(part->headers, name, value) ;
+
+	if (! strcasecmp(name, "Content-Disposition"))
+	{
+		part->key = disposition_param(parser->pool, value, "name") ;
+		part->filename = disposition_param(parser->pool, value, "filename") ;
+	}
+	else if (! strcasecmp(name, "Content-Type"))
+		part->content_type = value ;
+
+	return	SUCCESS ;
+}
+
+/* 이전 part 에서 쓴 digest 가 있으면 reset 해서 재사용 */
+static	DIGEST_T *	multipart_digest_reset (MULTIPART_PARSER_T * parser, DIGEST_T * digest, int type)
+{
+	if (digest && tb_digest_reset(digest) == SUCCESS)
+		return	digest ;
+
+	return	tb_digest_make(parser->pool, type) ;
+}
+
+/* part data 전달. preamble 은 버림 */
+static	int	multipart_emit (MULTIPART_PARSER_T * parser, const char * buf, size_t len)
+{
+	if (parser->state != MULTIPART_STATE_DATA || !len)
+		return	SUCCESS ;
+
+	parser->part->data_n += len ;
+
+	if (parser->digests & MULTIPART_DIGEST_MD5)
+		tb_digest_update(parser->md5, buf, len) ;
+	if (parser->digests & MULTIPART_DIGEST_SHA256)
+		tb_digest_update(parser->sha256, buf, len) ;
+
+	if (parser->callback->part_data)
+		return	parser->callback->part_data(parser->data, parser->part, buf, len) ;
+
+	return	SUCCESS ;
+}
+
+/* delimiter 를 찾은 경우. 진행중인 part 를 끝내고 boundary 뒷부분 처리 상태로 전환 */
+static	int	multipart_delimiter_found (MULTIPART_PARSER_T * parser)
+{
+	int	ret = SUCCESS ;
+
+	if (parser->digests & MULTIPART_DIGEST_MD5)
+		tb_digest_final(parser->md5, parser->part->md5) ;
+	if (parser->digests & MULTIPART_DIGEST_SHA256)
+		tb_digest_final(parser->sha256, parser->part->sha256) ;
+	if (parser->part)
+		parser->part->digests = parser->digests ;
+	parser->digests = 0 ;
+
+	if (parser->state == MULTIPART_STATE_DATA && parser->callback->part_end)
+		ret = parser->callback->part_end(parser->data, parser->part) ;
+
+	parser->part = NULL ;
+	parser->state = MULTIPART_STATE_BOUNDARY ;
+
+	return	ret ;
+}
+
+/* preamble, part data 에서 delimiter 탐색. 처리한 위치 반환, 실패시 NULL 반환 */
+static	const char *	multipart_parse_data (MULTIPART_PARSER_T * parser, const char * p, const char * e)
+{
+	const char *	delimiter = parser->delimiter ;
+	size_t		delimiter_n = parser->delimiter_n ;
+
+	/* 이전 chunk 끝에서 부분 매칭된 delimiter 이어서 비교 */
+	if (parser->match)
+	{
+		size_t	match = parser->match ;
+		while (p < e && match < delimiter_n && *p == delimiter[match])
+			p++, match++ ;
+
+		if (match == delimiter_n)
+		{
+			parser->match = 0 ;
+			return	multipart_delimiter_found(parser) == SUCCESS ? p : NULL ;
+		}
+
+		if (p == e)
+		{
+			parser->match = match ;
+			return	p ;
+		}
+
+		/* 매칭 실패. 보류했던 부분은 delimiter 와 같은 내용이므로 delimiter 에서 전달.
+		   boundary 에는 '\r' 이 없어서 보류했던 부분 중간에서 delimiter 가 다시 시작될 수 없음 */
+		parser->match = 0 ;
+		if (multipart_emit(parser, delimiter, match) != SUCCESS)
+			return	NULL ;
+	}
+
+	/* binary 데이터여서 strstr 사용하면 중간에 잘릴 수 있어서 tb_memsearch 사용함 */
+	const char *	q = tb_memsearch(&parser->search, p, e - p) ;
+	if (q)
+	{
+		if (multipart_emit(parser, p, q - p) != SUCCESS)
+			return	NULL ;
+
+		return	multipart_delimiter_found(parser) == SUCCESS ? q + delimiter_n : NULL ;
+	}
+
+	/* chunk 끝부분이 delimiter 앞부분과 일치하면 다음 chunk 에서 이어서 비교하기 위해 보류 */
+	const char *	hold = e - (e - p < delimiter_n ? e - p : delimiter_n - 1) ;
+	while ((hold = memchr(hold, '\r', e - hold)))
+	{
+		if (! memcmp(hold, delimiter, e - hold))
+			break ;
+		hold++ ;
+	}
+	if (! hold)
+		hold = e ;
+
+	if (multipart_emit(parser, p, hold - p) != SUCCESS)
+		return	NULL ;
+
+	parser->match = e - hold ;
+
+	return	e ;
+}
+
+/* part header 처리. 빈 줄을 만나면 part data 시작 */
+static	const char *	multipart_parse_header_line (MULTIPART_PARSER_T * parser, const char * p, const char * e, apr_off_t base)
+{
+	const char *	nl = memchr(p, '\n', e - p) ;
+	size_t		len = (nl ? nl : e) - p ;
+
+	if (parser->header_n + len >= _N(parser->header))
+		return	NULL ;
+
+	memcpy(parser->header + parser->header_n, p, len) ;
+	parser->header_n += len ;
+
+	if (! nl)
+		return	e ;
+
+	if (parser->header_n == 0 || (parser->header_n == 1 && *parser->header == '\r'))
+	{
+		/* header 끝 */
+		parser->part->offset = base + (nl + 1 - p) ;
+		parser->state = MULTIPART_STATE_DATA ;
+
+		/* file part 만 digest 계산 */
+		if (parser->part->filename && *parser->part->filename)
+			parser->digests = parser->callback->digests & (MULTIPART_DIGEST_MD5 | MULTIPART_DIGEST_SHA256) ;
+		if ((parser->digests & MULTIPART_DIGEST_MD5) && !(parser->md5 = multipart_digest_reset(parser, parser->md5, DIGEST_MD5)))
+			parser->digests &= ~MULTIPART_DIGEST_MD5 ;
+		if ((parser->digests & MULTIPART_DIGEST_SHA256) && !(parser->sha256 = multipart_digest_reset(parser, parser->sha256, DIGEST_SHA256)))
+			parser->digests &= ~MULTIPART_DIGEST_SHA256 ;
+
+		if (parser->callback->part_begin && parser->callback->part_begin(parser->data, parser->part) != SUCCESS)
+			return	NULL ;
+	}
+	else if (multipart_parse_header(parser) != SUCCESS)
+		return	NULL ;
+
+	parser->header_n = 0 ;
+
+	return	nl + 1 ;
+}
+
+/** @fn int	tb_multipart_parser_execute (MULTIPART_PARSER_T * parser, const char * buf, size_t len)
+    @brief	body chunk 를 parser 에 입력. chunk 는 임의의 위치에서 잘려도 됨
+    @param	parser	multipart parser
+    @param	buf	body chunk
+    @param	len	chunk 길이
+    @return	성공시 SUCCESS, body 형식이 잘못됐거나 callback 이 FAIL 반환한 경우 FAIL
+*/
+int	tb_multipart_parser_execute (MULTIPART_PARSER_T * parser, const char * buf, size_t len)
+{
+	const char *	p = buf ;
+	const char *	e = buf + len ;
+
+	while (p && p < e)
+	{
+		switch (parser->state)
+		{
+			case MULTIPART_STATE_PREAMBLE :
+			case MULTIPART_STATE_DATA :
+				p = multipart_parse_data(parser, p, e) ;
+				break ;
+
+			case MULTIPART_STATE_BOUNDARY :
+				/* delimiter 뒤에는 "--" (마지막) 또는 공백 + CRLF 가 와야함 */
+				if (*p == '-')
+					parser->state = MULTIPART_STATE_BOUNDARY_DASH ;
+				else if (*p == '\r')
+					parser->state = MULTIPART_STATE_BOUNDARY_CR ;
+				else if (*p != ' ' && *p != '\t')
+					p = NULL ;
+
+				if (p) p++ ;
+				break ;
+
+			case MULTIPART_STATE_BOUNDARY_DASH :
+				parser->state = MULTIPART_STATE_END ;
+				p = *p == '-' ? e : NULL ;
+				break ;
+
+			case MULTIPART_STATE_BOUNDARY_CR :
+				if (*p++ != '\n')
+				{
+					p = NULL ;
+					break ;
+				}
+
+				parser->part = apr_pcalloc(parser->pool, sizeof(MULTIPART_PART_T)) ;
+				parser->part->headers = apr_table_make(parser->pool, 2) ;
+				parser->header_n = 0 ;
+				parser->state = MULTIPART_STATE_HEADER ;
+				break ;
+
+			case MULTIPART_STATE_HEADER :
+				p = multipart_parse_header_line(parser, p, e, parser->offset + (p - buf)) ;
+				break ;
+
+			case MULTIPART_STATE_END :
+				/* epilogue 는 무시 */
+				p = e ;
+				break ;
+
+			default :
+				p = NULL ;
+				break ;
+		}
+	}
+
+	parser->offset += len ;
+
+	if (! p)
+	{
+		parser->state = MULTIPART_STATE_ERROR ;
+		return	FAIL ;
+	}
+
+	return	SUCCESS ;
+}
+
+/** @fn int	tb_multipart_parser_finish (MULTIPART_PARSER_T * parser)
+    @brief	body 입력 완료. 마지막 boundary 까지 정상적으로 읽었는지 확인
+    @param	parser	multipart parser
+    @return	마지막 boundary 까지 읽은 경우 SUCCESS, body 가 중간에 끊긴 경우 FAIL
+*/
+int	tb_multipart_parser_finish (MULTIPART_PARSER_T * parser)
+{
+	return	parser && parser->state == MULTIPART_STATE_END ? SUCCESS : FAIL ;
+}
+
+/** @fn const char *	tb_multipart_digest_hex (apr_pool_t * pool, const MULTIPART_PART_T * part, int digest)
+    @brief	part 를 받으면서 계산한 digest 를 hex 문자열로 읽기
+    @param	pool	메모리 할당 풀
+    @param	part	multipart part
+    @param	digest	MULTIPART_DIGEST_MD5 또는 MULTIPART_DIGEST_SHA256
+    @return	hex 문자열. 계산하지 않은 digest 인 경우 NULL 반환
+*/
+const char *	tb_multipart_digest_hex (apr_pool_t * pool, const MULTIPART_PART_T * part, int digest)
+{
+	if (!part || (digest != MULTIPART_DIGEST_MD5 && digest != MULTIPART_DIGEST_SHA256) || !(part->digests & digest))
+		return	NULL ;
+
+	const unsigned char *	hash = digest == MULTIPART_DIGEST_MD5 ? part->md5 : part->sha256 ;
+	size_t			hash_n = digest == MULTIPART_DIGEST_MD5 ? sizeof(part->md5) : sizeof(part->sha256) ;
+	char *			result = apr_palloc(pool, hash_n * 2 + 1) ;
+
+	tb_hex_encode(result, hash, hash_n) ;
+
+	return	result ;
+}
@@ -0,0 +1,827 @@
+//vim:ts=8
+
+/** @file number.c
+    숫자와 문자열 변환. printf, atoi 계열을 쓰지 않아서 locale 에 영향받지 않음
+*/
+
+#ifndef	_GNU_SOURCE
+#define	_GNU_SOURCE	/* strtod_l */
+#endif
+
+#include "turbo.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <locale.h>
+#include <pthread.h>
+
+/* 00 ~ 99 두 자리씩 변환하는 표 */
+static	const char	digit_pairs [201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899" ;
+
+/** @fn char *	tb_utoa (char * buf, unsigned long value)
+    @brief	부호 없는 정수를 10진수 문자열로 변환. 두 자리씩 표에서 복사함
+    @param	buf	출력 버퍼. TB_NUMBER_BUF_SIZE 이상이어야 함
+    @param	value	값
+    @return	buf 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_utoa (char * buf, unsigned long value)
+{
+	char	tmp [24] ;
+	char *	p = tmp + sizeof(tmp) ;
+
+	while (value >= 100)
+	{
+		unsigned int	i = (value % 100) * 2 ;
+		value /= 100 ;
+		p -= 2 ;
+		memcpy(p, digit_pairs + i, 2) ;
+	}
+
+	if (value >= 10)
+	{
+		p -= 2 ;
+		memcpy(p, digit_pairs + value * 2, 2) ;
+	}
+	else
+		*--p = '0' + value ;
+
+	size_t	n = tmp + sizeof(tmp) - p ;
+	memcpy(buf, p, n) ;
+	buf[n] = '\0' ;
+
+	return	buf + n ;
+}
+
+/** @fn char *	tb_ltoa (char * buf, long value)
+    @brief	정수를 10진수 문자열로 변환
+    @param	buf	출력 버퍼. TB_NUMBER_BUF_SIZE 이상이어야 함
+    @param	value	값
+    @return	buf 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_ltoa (char * buf, long value)
+{
+	if (value < 0)
+	{
+		*buf++ = '-' ;
+		return	tb_utoa(buf, 0 - (unsigned long)value) ;
+	}
+
+	return	tb_utoa(buf, value) ;
+}
+
+/* Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers").
+   가장 짧은 자릿수를 항상 보장하지는 않지만 다시 읽으면 항상 같은 값이 되고 대부분 가장 짧음 */
+
+typedef struct
+{
+	uint64_t	f ;
+	int		e ;
+} DIYFP_T ;
+
+/* 10^k 를 정규화한 64bit 값. k 는 -300 부터 8씩 증가 */
+static	const struct
+{
+	uint64_t	f ;
+	int		e ;
+	int		k ;
+}	cached_powers [] =
+{
+	{ 0xAB70FE17C79AC6CAULL, -1060, -300 },
+	{ 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+	{ 0xBE5691EF416BD60CULL, -1007, -284 },
+	{ 0x8DD01FAD907FFC3CULL,  -980, -276 },
+	{ 0xD3515C2831559A83ULL,  -954, -268 },
+	{ 0x9D71AC8FADA6C9B5ULL,  -927, -260 },
+	{ 0xEA9C227723EE8BCBULL,  -901, -252 },
+	{ 0xAECC49914078536DULL,  -874, -244 },
+	{ 0x823C12795DB6CE57ULL,  -847, -236 },
+	{ 0xC21094364DFB5637ULL,  -821, -228 },
+	{ 0x9096EA6F3848984FULL,  -794, -220 },
+	{ 0xD77485CB25823AC7ULL,  -768, -212 },
+	{ 0xA086CFCD97BF97F4ULL,  -741, -204 },
+	{ 0xEF340A98172AACE5ULL,  -715, -196 },
+	{ 0xB23867FB2A35B28EULL,  -688, -188 },
+	{ 0x84C8D4DFD2C63F3BULL,  -661, -180 },
+	{ 0xC5DD44271AD3CDBAULL,  -635, -172 },
+	{ 0x936B9FCEBB25C996ULL,  -608, -164 },
+	{ 0xDBAC6C247D62A584ULL,  -582, -156 },
+	{ 0xA3AB66580D5FDAF6ULL,  -555, -148 },
+	{ 0xF3E2F893DEC3F126ULL,  -529, -140 },
+	{ 0xB5B5ADA8AAFF80B8ULL,  -502, -132 },
+	{ 0x87625F056C7C4A8BULL,  -475, -124 },
+	{ 0xC9BCFF6034C13053ULL,  -449, -116 },
+	{ 0x964E858C91BA2655ULL,  -422, -108 },
+	{ 0xDFF9772470297EBDULL,  -396, -100 },
+	{ 0xA6DFBD9FB8E5B88FULL,  -369,  -92 },
+	{ 0xF8A95FCF88747D94ULL,  -343,  -84 },
+	{ 0xB94470938FA89BCFULL,  -316,  -76 },
+	{ 0x8A08F0F8BF0F156BULL,  -289,  -68 },
+	{ 0xCDB02555653131B6ULL,  -263,  -60 },
+	{ 0x993FE2C6D07B7FACULL,  -236,  -52 },
+	{ 0xE45C10C42A2B3B06ULL,  -210,  -44 },
+	{ 0xAA242499697392D3ULL,  -183,  -36 },
+	{ 0xFD87B5F28300CA0EULL,  -157,  -28 },
+	{ 0xBCE5086492111AEBULL,  -130,  -20 },
+	{ 0x8CBCCC096F5088CCULL,  -103,  -12 },
+	{ 0xD1B71758E219652CULL,   -77,   -4 },
+	{ 0x9C40000000000000ULL,   -50,    4 },
+	{ 0xE8D4A51000000000ULL,   -24,   12 },
+	{ 0xAD78EBC5AC620000ULL,     3,   20 },
+	{ 0x813F3978F8940984ULL,    30,   28 },
+	{ 0xC097CE7BC90715B3ULL,    56,   36 },
+	{ 0x8F7E32CE7BEA5C70ULL,    83,   44 },
+	{ 0xD5D238A4ABE98068ULL,   109,   52 },
+	{ 0x9F4F2726179A2245ULL,   136,   60 },
+	{ 0xED63A231D4C4FB27ULL,   162,   68 },
+	{ 0xB0DE65388CC8ADA8ULL,   189,   76 },
+	{ 0x83C7088E1AAB65DBULL,   216,   84 },
+	{ 0xC45D1DF942711D9AULL,   242,   92 },
+	{ 0x924D692CA61BE758ULL,   269,  100 },
+	{ 0xDA01EE641A708DEAULL,   295,  108 },
+	{ 0xA26DA3999AEF774AULL,   322,  116 },
+	{ 0xF209787BB47D6B85ULL,   348,  124 },
+	{ 0xB454E4A179DD1877ULL,   375,  132 },
+	{ 0x865B86925B9BC5C2ULL,   402,  140 },
+	{ 0xC83553C5C8965D3DULL,   428,  148 },
+	{ 0x952AB45CFA97A0B3ULL,   455,  156 },
+	{ 0xDE469FBD99A05FE3ULL,   481,  164 },
+	{ 0xA59BC234DB398C25ULL,   508,  172 },
+	{ 0xF6C69A72A3989F5CULL,   534,  180 },
+	{ 0xB7DCBF5354E9BECEULL,   561,  188 },
+	{ 0x88FCF317F22241E2ULL,   588,  196 },
+	{ 0xCC20CE9BD35C78A5ULL,   614,  204 },
+	{ 0x98165AF37B2153DFULL,   641,  212 },
+	{ 0xE2A0B5DC971F303AULL,   667,  220 },
+	{ 0xA8D9D1535CE3B396ULL,   694,  228 },
+	{ 0xFB9B7CD9A4A7443CULL,   720,  236 },
+	{ 0xBB764C4CA7A44410ULL,   747,  244 },
+	{ 0x8BAB8EEFB6409C1AULL,   774,  252 },
+	{ 0xD01FEF10A657842CULL,   800,  260 },
+	{ 0x9B10A4E5E9913129ULL,   827,  268 },
+	{ 0xE7109BFBA19C0C9DULL,   853,  276 },
+	{ 0xAC2820D9623BF429ULL,   880,  284 },
+	{ 0x80444B5E7AA7CF85ULL,   907,  292 },
+	{ 0xBF21E44003ACDD2DULL,   933,  300 },
+	{ 0x8E679C2F5E44FF8FULL,   960,  308 },
+	{ 0xD433179D9C8CB841ULL,   986,  316 },
+	{ 0x9E19DB92B4E31BA9ULL,  1013,  324 },
+
+} ;
+
+#define	GRISU_ALPHA		-60
+#define	GRISU_GAMMA		-32
+#define	CACHED_POWERS_MIN_EXP	-300
+#define	CACHED_POWERS_STEP	8
+
+static	DIYFP_T	diyfp_make (uint64_t f, int e)
+{
+	DIYFP_T	x = { f, e } ;
+	return	x ;
+}
+
+/* 두 값의 곱. 128bit 결과의 상위 64bit 를 반올림 */
+static	DIYFP_T	diyfp_mul (DIYFP_T x, DIYFP_T y)
+{
+	unsigned __int128	p = (unsigned __int128)x.f * y.f ;
+	uint64_t		h = (uint64_t)(p >> 64) + ((uint64_t)p >> 63) ;
+
+	return	diyfp_make(h, x.e + y.e + 64) ;
+}
+
+static	DIYFP_T	diyfp_normalize (DIYFP_T x)
+{
+	int	shift = __builtin_clzll(x.f) ;
+	return	diyfp_make(x.f << shift, x.e - shift) ;
+}
+
+/* 값 v 와 반올림해서 v 가 되는 구간의 경계 m-, m+ 계산. digits 는 hidden bit 포함한 가수 bit 수 */
+static	void	grisu_boundaries (uint64_t F, int E, int digits, int exp_bias, DIYFP_T * v, DIYFP_T * minus, DIYFP_T * plus)
+{
+	int		bias = exp_bias + digits - 1 ;
+	uint64_t	hidden = (uint64_t)1 << (digits - 1) ;
+
+	*v = E ? diyfp_make(F + hidden, E - bias) : diyfp_make(F, 1 - bias) ;
+
+	/* 가수가 2의 거듭제곱이면 아래쪽 간격이 절반 */
+	int		lower_closer = F == 0 && E > 1 ;
+	DIYFP_T		m_plus = diyfp_make(2 * v->f + 1, v->e - 1) ;
+	DIYFP_T		m_minus = lower_closer ? diyfp_make(4 * v->f - 1, v->e - 2) : diyfp_make(2 * v->f - 1, v->e - 1) ;
+
+	*plus = diyfp_normalize(m_plus) ;
+	*minus = diyfp_make(m_minus.f << (m_minus.e - plus->e), plus->e) ;
+	*v = diyfp_normalize(*v) ;
+}
+
+/* 마지막 자리를 v 에 더 가깝게 조정 */
+static	void	grisu_round (char * buf, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+	while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+	{
+		buf[len - 1]-- ;
+		rest += ten_k ;
+	}
+}
+
+static	int	grisu_pow10 (uint32_t n, uint32_t * pow10)
+{
+	static const uint32_t	pows [] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 } ;
+	int	k = 10 ;
+
+	while (k > 1 && n < pows[k - 1])
+		k-- ;
+	*pow10 = pows[k - 1] ;
+
+	return	k ;
+}
+
+/* [M-, M+] 구간 안에서 가장 짧은 자릿수 생성 */
+static	int	grisu_digits (char * buf, int * exponent, DIYFP_T M_minus, DIYFP_T w, DIYFP_T M_plus)
+{
+	uint64_t	delta = M_plus.f - M_minus.f ;
+	uint64_t	dist = M_plus.f - w.f ;
+	int		shift = -M_plus.e ;
+	uint64_t	one = (uint64_t)1 << shift ;
+	uint32_t	p1 = (uint32_t)(M_plus.f >> shift) ;
+	uint64_t	p2 = M_plus.f & (one - 1) ;
+	uint32_t	pow10 ;
+	int		n = grisu_pow10(p1, &pow10) ;
+	int		len = 0 ;
+
+	while (n > 0)
+	{
+		buf[len++] = '0' + p1 / pow10 ;
+		p1 %= pow10 ;
+		n-- ;
+
+		uint64_t	rest = ((uint64_t)p1 << shift) + p2 ;
+		if (rest <= delta)
+		{
+			*exponent += n ;
+			grisu_round(buf, len, dist, delta, rest, (uint64_t)pow10 << shift) ;
+			return	len ;
+		}
+
+		pow10 /= 10 ;
+	}
+
+	int	m = 0 ;
+	for (;;)
+	{
+		p2 *= 10 ;
+		buf[len++] = '0' + (p2 >> shift) ;
+		p2 &= one - 1 ;
+		m++ ;
+
+		delta *= 10 ;
+		dist *= 10 ;
+		if (p2 <= delta)
+			break ;
+	}
+
+	*exponent -= m ;
+	grisu_round(buf, len, dist, delta, p2, one) ;
+
+	return	len ;
+}
+
+/* 양수 v 를 digits * 10^exponent 형태로 변환해서 자릿수 반환 */
+static	int	grisu2 (char * buf, int * exponent, DIYFP_T v, DIYFP_T minus, DIYFP_T plus)
+{
+	/* 곱한 결과의 지수가 [alpha, gamma] 에 들어가도록 10^-k 선택 */
+	int	f = GRISU_ALPHA - plus.e - 1 ;
+	int	k = (f * 78913) / (1 << 18) + (f > 0) ;
+	int	index = (-CACHED_POWERS_MIN_EXP + k + (CACHED_POWERS_STEP - 1)) / CACHED_POWERS_STEP ;
+
+	DIYFP_T	c = diyfp_make(cached_powers[index].f, cached_powers[index].e) ;
+	DIYFP_T	w = diyfp_mul(v, c) ;
+	DIYFP_T	w_minus = diyfp_mul(minus, c) ;
+	DIYFP_T	w_plus = diyfp_mul(plus, c) ;
+
+	*exponent = -cached_powers[index].k ;
+
+	return	grisu_digits(buf, exponent, diyfp_make(w_minus.f + 1, w_minus.e), w, diyfp_make(w_plus.f - 1, w_plus.e)) ;
+}
+
+/* digits * 10^exponent 를 JavaScript 와 같은 형식으로 출력. 10^21 이상, 10^-7 미만은 지수 표기 */
+static	char *	grisu_format (char * buf, int len, int exponent)
+{
+	int	n = len + exponent ;	/* 소수점 위치 */
+
+	if (len <= n && n <= 21)
+	{
+		/* 1234e2 -> 123400 */
+		memset(buf + len, '0', n - len) ;
+		buf += n ;
+	}
+	else if (0 < n && n <= 21)
+	{
+		/* 1234e-2 -> 12.34 */
+		memmove(buf + n + 1, buf + n, len - n) ;
+		buf[n] = '.' ;
+		buf += len + 1 ;
+	}
+	else if (-6 < n && n <= 0)
+	{
+		/* 1234e-6 -> 0.001234 */
+		memmove(buf + 2 - n, buf, len) ;
+		buf[0] = '0' ;
+		buf[1] = '.' ;
+		memset(buf + 2, '0', -n) ;
+		buf += 2 - n + len ;
+	}
+	else
+	{
+		/* 1234e30 -> 1.234e+33 */
+		if (len > 1)
+		{
+			memmove(buf + 2, buf + 1, len - 1) ;
+			buf[1] = '.' ;
+			buf += len + 1 ;
+		}
+		else
+			buf++ ;
+
+		*buf++ = 'e' ;
+		*buf++ = n - 1 < 0 ? '-' : '+' ;
+		buf = tb_utoa(buf, n - 1 < 0 ? 1 - n : n - 1) ;
+	}
+
+	*buf = '\0' ;
+
+	return	buf ;
+}
+
+/* 부호, 0, NaN/Infinity 처리. 처리했으면 끝 위치 반환 */
+static	char *	dtoa_special (char ** buf, double value)
+{
+	if (! isfinite(value))
+	{
+		memcpy(*buf, "null", 5) ;
+		return	*buf + 4 ;
+	}
+
+	if (signbit(value))
+		*(*buf)++ = '-' ;
+
+	if (value == 0)
+	{
+		memcpy(*buf, "0", 2) ;
+		return	*buf + 1 ;
+	}
+
+	return	NULL ;
+}
+
+/** @fn char *	tb_dtoa (char * buf, double value)
+    @brief	실수를 다시 읽었을 때 같은 값이 되는 가장 짧은 문자열로 변환(Grisu2). 0.1 은 0.1, 1e21 이상은 1e+21 처럼 지수 표기.
+		NaN, Infinity 는 JSON 에 없으므로 null 출력
+    @param	buf	출력 버퍼. TB_NUMBER_BUF_SIZE 이상이어야 함
+    @param	value	값
+    @return	buf 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_dtoa (char * buf, double value)
+{
+	char *	e = dtoa_special(&buf, value) ;
+	if (e)
+		return	e ;
+
+	uint64_t	bits ;
+	DIYFP_T		v, minus, plus ;
+	int		exponent ;
+
+	memcpy(&bits, &value, sizeof(bits)) ;
+	grisu_boundaries(bits & (((uint64_t)1 << 52) - 1), (bits >> 52) & 0x7ff, 53, 1023, &v, &minus, &plus) ;
+
+	int	len = grisu2(buf, &exponent, v, minus, plus) ;
+
+	return	grisu_format(buf, len, exponent) ;
+}
+
+/** @fn char *	tb_ftoa (char * buf, float value)
+    @brief	float 를 다시 읽었을 때 같은 float 이 되는 가장 짧은 문자열로 변환. 0.1f 를 double 로 바꿔서 출력하면 0.10000000149011612 가 되는 문제 없음
+    @param	buf	출력 버퍼. TB_NUMBER_BUF_SIZE 이상이어야 함
+    @param	value	값
+    @return	buf 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_ftoa (char * buf, float value)
+{
+	char *	e = dtoa_special(&buf, value) ;
+	if (e)
+		return	e ;
+
+	uint32_t	bits ;
+	DIYFP_T		v, minus, plus ;
+	int		exponent ;
+
+	memcpy(&bits, &value, sizeof(bits)) ;
+	grisu_boundaries(bits & ((1u << 23) - 1), (bits >> 23) & 0xff, 24, 127, &v, &minus, &plus) ;
+
+	int	len = grisu2(buf, &exponent, v, minus, plus) ;
+
+	return	grisu_format(buf, len, exponent) ;
+}
+
+/** @fn char *	tb_dtoa_fixed (char * buf, double value, int precision)
+    @brief	실수를 소수점 아래 precision 자리로 반올림해서 변환. printf 의 %.2f 와 같은 형식.
+		precision 이 17 보다 크거나 결과가 TB_NUMBER_BUF_SIZE 에 들어가지 않을 만큼 크면 tb_dtoa 와 같이 출력
+    @param	buf		출력 버퍼. TB_NUMBER_BUF_SIZE 이상이어야 함
+    @param	value		값
+    @param	precision	소수점 아래 자릿수. 0 ~ 17. 음수면 tb_dtoa 와 같음
+    @return	buf 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_dtoa_fixed (char * buf, double value, int precision)
+{
+	static const uint64_t	pows [] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+					10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+					1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL } ;
+
+	if (precision < 0 || precision >= (int)_N(pows) || !isfinite(value))
+		return	tb_dtoa(buf, value) ;
+
+	double	a = fabs(value) ;
+	if (a >= 18446744073709551616.0)
+		return	tb_dtoa(buf, value) ;
+
+	/* 정수 부분과 소수 부분은 둘 다 정확히 나타낼 수 있음 */
+	double		ip_d = floor(a) ;
+	double		f = a - ip_d ;
+	uint64_t	ip = (uint64_t)ip_d ;
+	uint64_t	frac = 0 ;
+
+	if (f > 0)
+	{
+		/* f = m * 2^-k 이므로 f * 10^precision 을 128 bit 정수로 정확히 계산하고 printf 와 같이 반올림(정확히 절반이면 짝수) */
+		int		e ;
+		double		mant = frexp(f, &e) ;
+		uint64_t	m = (uint64_t)ldexp(mant, 53) ;
+		int		k = 53 - e ;
+
+		/* k > 120 이면 f < 2^-67 이라 f * 10^17 도 0.5 보다 작음 */
+		if (k <= 120)
+		{
+			unsigned __int128	v = (unsigned __int128)m * pows[precision] ;
+			unsigned __int128	rem = v & ((((unsigned __int128)1) << k) - 1) ;
+			unsigned __int128	half = ((unsigned __int128)1) << (k - 1) ;
+
+			frac = (uint64_t)(v >> k) ;
+			if (rem > half || (rem == half && ((precision ? frac : ip) & 1)))
+				frac++ ;
+
+			if (frac == pows[precision])
+				frac = 0, ip++ ;
+		}
+	}
+
+	char	digits [TB_NUMBER_BUF_SIZE] ;
+	int	digits_n = tb_utoa(digits, ip) - digits ;
+	if (1 + digits_n + 1 + precision >= TB_NUMBER_BUF_SIZE)
+		return	tb_dtoa(buf, value) ;
+
+	if (signbit(value))
+		*buf++ = '-' ;
+
+	memcpy(buf, digits, digits_n) ;
+	buf += digits_n ;
+
+	if (precision)
+	{
+		char	frac_buf [TB_NUMBER_BUF_SIZE] ;
+		int	frac_n = tb_utoa(frac_buf, frac) - frac_buf ;
+
+		*buf++ = '.' ;
+		memset(buf, '0', precision - frac_n) ;
+		memcpy(buf + precision - frac_n, frac_buf, frac_n) ;
+		buf += precision ;
+	}
+	*buf = '\0' ;
+
+	return	buf ;
+}
+
+/* 8 byte 가 모두 숫자인지 검사 */
+static	int	swar_is_8digits (uint64_t v)
+{
+	return	!(((v + 0x4646464646464646ULL) | (v - 0x3030303030303030ULL)) & 0x8080808080808080ULL) ;
+}
+
+/* 숫자 8자를 한 번에 변환. little endian 기준 */
+static	uint32_t	swar_parse_8digits (uint64_t v)
+{
+	const uint64_t	mask = 0x000000FF000000FFULL ;
+	const uint64_t	mul1 = 0x000F424000000064ULL ;	/* 100 + (1000000 << 32) */
+	const uint64_t	mul2 = 0x0000271000000001ULL ;	/* 1 + (10000 << 32) */
+
+	v -= 0x3030303030303030ULL ;
+	v = (v * 10) + (v >> 8) ;
+	v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32 ;
+
+	return	(uint32_t)v ;
+}
+
+/* [0-9]+ 를 부호 없는 값으로 변환. 19자리 이하는 overflow 검사 없이 8자리씩 변환하고 마지막에 max 와 비교 */
+static	int	parse_unsigned (const char * p, const char * e, unsigned long max, unsigned long * value)
+{
+	unsigned long	v = 0 ;
+	int		overflow = 0 ;
+
+	if (p >= e)
+		return	FAIL ;
+
+	while (e - p > 1 && *p == '0')
+		p++ ;
+
+	if (e - p <= 19)
+	{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		while (e - p >= 8)
+		{
+			uint64_t	chunk ;
+			memcpy(&chunk, p, 8) ;
+			if (! swar_is_8digits(chunk))
+				return	FAIL ;
+
+			v = v * 100000000 + swar_parse_8digits(chunk) ;
+			p += 8 ;
+		}
+#endif
+		for (; p < e; p++)
+		{
+			unsigned int	d = (unsigned char)*p - '0' ;
+			if (d > 9)
+				return	FAIL ;
+			v = v * 10 + d ;
+		}
+
+		overflow = v > max ;
+	}
+	else
+	{
+		for (; p < e; p++)
+		{
+			unsigned int	d = (unsigned char)*p - '0' ;
+			if (d > 9)
+				return	FAIL ;
+
+			/* 숫자가 아닌 문자가 있으면 FAIL 이어야 하므로 끝까지 검사 */
+			if (overflow || v > (max - d) / 10)
+				overflow = 1 ;
+			else
+				v = v * 10 + d ;
+		}
+	}
+
+	if (overflow)
+		return	TB_PARSE_OVERFLOW ;
+
+	*value = v ;
+
+	return	SUCCESS ;
+}
+
+/* [+-]?[0-9]+ 변환. 음수는 max + 1 까지 허용 */
+static	int	parse_signed (const char * src, size_t len, unsigned long max, long * value)
+{
+	const char *	p = src ;
+	const char *	e = src + len ;
+	int		negative = 0 ;
+	unsigned long	v ;
+
+	if (p < e && (*p == '-' || *p == '+'))
+		negative = *p++ == '-' ;
+
+	int	rv = parse_unsigned(p, e, max + negative, &v) ;
+	if (rv != SUCCESS)
+		return	rv ;
+
+	*value = negative ? (long)(0 - v) : (long)v ;
+
+	return	SUCCESS ;
+}
+
+/** @fn int	tb_parse_long (const char * src, size_t len, long * value)
+    @brief	문자열 전체를 long 으로 변환. 부호([+-]) 와 숫자만 허용하고 공백이나 다른 문자가 있으면 실패. locale 에 영향받지 않음
+    @param	src	변환할 문자열. NULL 종료되지 않아도 됨
+    @param	len	문자열 길이
+    @param	value	변환한 값. 실패시 바꾸지 않음
+    @return	성공시 SUCCESS, 숫자가 아니면 FAIL, 범위를 넘으면 TB_PARSE_OVERFLOW
+*/
+int	tb_parse_long (const char * src, size_t len, long * value)
+{
+	return	parse_signed(src, len, LONG_MAX, value) ;
+}
+
+/** @fn int	tb_parse_int (const char * src, size_t len, int * value)
+    @brief	문자열 전체를 int 로 변환. 부호([+-]) 와 숫자만 허용하고 공백이나 다른 문자가 있으면 실패. locale 에 영향받지 않음
+    @param	src	변환할 문자열. NULL 종료되지 않아도 됨
+    @param	len	문자열 길이
+    @param	value	변환한 값. 실패시 바꾸지 않음
+    @return	성공시 SUCCESS, 숫자가 아니면 FAIL, 범위를 넘으면 TB_PARSE_OVERFLOW
+*/
+int	tb_parse_int (const char * src, size_t len, int * value)
+{
+	long	v ;
+	int	rv = parse_signed(src, len, INT_MAX, &v) ;
+
+	if (rv == SUCCESS)
+		*value = (int)v ;
+
+	return	rv ;
+}
+
+/** @fn int	tb_parse_long_prefix (const char * src, size_t len, long * value, const char ** end)
+    @brief	문자열 앞부분의 [+-]?[0-9]+ 만 long 으로 변환하고 뒤의 문자는 무시. "123.json" 은 123. locale 에 영향받지 않음
+    @param	src	변환할 문자열. NULL 종료되지 않아도 됨
+    @param	len	문자열 길이
+    @param	value	변환한 값. 실패시 바꾸지 않음
+    @param	end	변환한 숫자 다음 위치. 필요없으면 NULL
+    @return	성공시 SUCCESS, 숫자로 시작하지 않으면 FAIL, 범위를 넘으면 TB_PARSE_OVERFLOW
+*/
+int	tb_parse_long_prefix (const char * src, size_t len, long * value, const char ** end)
+{
+	const char *	p = src ;
+	const char *	e = src + len ;
+
+	if (p < e && (*p == '-' || *p == '+'))
+		p++ ;
+	while (p < e && (unsigned char)(*p - '0') <= 9)
+		p++ ;
+
+	if (end)
+		*end = p ;
+
+	return	parse_signed(src, p - src, LONG_MAX, value) ;
+}
+
+static	locale_t	c_locale ;
+static	pthread_once_t	c_locale_once = PTHREAD_ONCE_INIT ;
+
+static	void	c_locale_init (void)
+{
+	c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0) ;
+}
+
+/* 정확한 반올림이 필요한 경우. 형식은 이미 검사했으므로 C locale 의 strtod 로 변환 */
+static	double	parse_double_slow (const char * src, size_t len)
+{
+	char	buf [128] ;
+	char *	tmp = len < sizeof(buf) ? buf : malloc(len + 1) ;
+
+	memcpy(tmp, src, len) ;
+	tmp[len] = '\0' ;
+
+	pthread_once(&c_locale_once, c_locale_init) ;
+	double	d = strtod_l(tmp, NULL, c_locale) ;
+
+	if (tmp != buf)
+		free(tmp) ;
+
+	return	d ;
+}
+
+/** @fn int	tb_parse_double (const char * src, size_t len, double * value)
+    @brief	문자열 전체를 double 로 변환. JSON 숫자 형식에 앞의 + 와 .5 같은 형식도 허용. locale 에 영향받지 않고 소수점은 항상 '.'
+		유효숫자 15자리 이하이고 지수가 작은 대부분의 값은 strtod 없이 정확하게 변환함(Clinger fast path)
+    @param	src	변환할 문자열. NULL 종료되지 않아도 됨
+    @param	len	문자열 길이
+    @param	value	변환한 값. 실패시 바꾸지 않음
+    @return	성공시 SUCCESS, 숫자가 아니면 FAIL, 범위를 넘으면 TB_PARSE_OVERFLOW
+*/
+int	tb_parse_double (const char * src, size_t len, double * value)
+{
+	static const double	pows [] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 } ;
+
+	const char *	p = src ;
+	const char *	e = src + len ;
+	int		negative = 0 ;
+	uint64_t	m = 0 ;		/* 유효숫자 19자리까지 */
+	int		m_n = 0 ;
+	int		truncated = 0 ;
+	int		digits = 0 ;
+	long		exp10 = 0 ;
+
+	if (p < e && (*p == '-' || *p == '+'))
+		negative = *p++ == '-' ;
+
+	for (; p < e && (unsigned char)(*p - '0') <= 9; p++, digits++)
+	{
+		if (m_n < 19)
+		{
+			m = m * 10 + (*p - '0') ;
+			m_n += m != 0 ;
+		}
+		else
+		{
+			truncated |= *p != '0' ;
+			exp10++ ;
+		}
+	}
+
+	if (p < e && *p == '.')
+	{
+		for (p++; p < e && (unsigned char)(*p - '0') <= 9; p++, digits++)
+		{
+			if (m_n < 19)
+			{
+				m = m * 10 + (*p - '0') ;
+				m_n += m != 0 ;
+				exp10-- ;
+			}
+			else
+				truncated |= *p != '0' ;
+		}
+	}
+
+	if (! digits)
+		return	FAIL ;
+
+	if (p < e && (*p == 'e' || *p == 'E'))
+	{
+		int	exp_negative = 0 ;
+		long	exp = 0 ;
+
+		if (++p < e && (*p == '-' || *p == '+'))
+			exp_negative = *p++ == '-' ;
+		if (p >= e)
+			return	FAIL ;
+
+		for (; p < e && (unsigned char)(*p - '0') <= 9; p++)
+		{
+			if (exp < 100000)
+				exp = exp * 10 + (*p - '0') ;
+		}
+
+		exp10 += exp_negative ? -exp : exp ;
+	}
+
+	if (p != e)
+		return	FAIL ;
+
+	double	d ;
+	if (! m)
+		d = 0 ;
+	else if (!truncated && m <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22)
+		d = exp10 < 0 ? (double)m / pows[-exp10] : (double)m * pows[exp10] ;
+	else
+	{
+		d = parse_double_slow(src, len) ;
+		if (isinf(d))
+			return	TB_PARSE_OVERFLOW ;
+		negative = 0 ;
+	}
+
+	*value = negative ? -d : d ;
+
+	return	SUCCESS ;
+}
+
+/** @fn int	tb_parse_double_prefix (const char * src, size_t len, double * value, const char ** end)
+    @brief	문자열 앞부분의 숫자만 double 로 변환하고 뒤의 문자는 무시. "1.5px" 는 1.5. 형식과 변환은 tb_parse_double 과 같음
+    @param	src	변환할 문자열. NULL 종료되지 않아도 됨
+    @param	len	문자열 길이
+    @param	value	변환한 값. 실패시 바꾸지 않음
+    @param	end	변환한 숫자 다음 위치. 필요없으면 NULL
+    @return	성공시 SUCCESS, 숫자로 시작하지 않으면 FAIL, 범위를 넘으면 TB_PARSE_OVERFLOW
+*/
+int	tb_parse_double_prefix (const char * src, size_t len, double * value, const char ** end)
+{
+	const char *	p = src ;
+	const char *	e = src + len ;
+
+	if (p < e && (*p == '-' || *p == '+'))
+		p++ ;
+	while (p < e && (unsigned char)(*p - '0') <= 9)
+		p++ ;
+	if (p < e && *p == '.')
+	{
+		for (p++; p < e && (unsigned char)(*p - '0') <= 9; p++) ;
+	}
+
+	/* 지수 뒤에 숫자가 없으면 "1e" 의 e 는 숫자가 아님 */
+	if (p < e && (*p == 'e' || *p == 'E'))
+	{
+		const char *	x = p + 1 ;
+
+		if (x < e && (*x == '-' || *x == '+'))
+			x++ ;
+		if (x < e && (unsigned char)(*x - '0') <= 9)
+		{
+			for (p = x; p < e && (unsigned char)(*p - '0') <= 9; p++) ;
+		}
+	}
+
+	if (end)
+		*end = p ;
+
+	return	tb_parse_double(src, p - src, value) ;
+}
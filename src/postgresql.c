@@ -421,6 +421,81 @@ time_t	tb_postgre_result_time_t (PGresult * result, int row, int column, time_t
 	return	tb_atot(PQgetvalue(result, row, column), def) ;
 }
 
+/** @fn int	tb_postgre_column_integer (PGresult * result, int column, int * values, int def)
+    @brief	PGresult 의 한 column 전체를 integer 로 변환. PQgetlength 로 길이를 알고 있으므로 strlen 없이 tb_parse_int 로 바로 변환
+    @param	result	PGresult
+    @param	column	column index. 0부터 시작
+    @param	values	변환한 값 저장할 배열. PQntuples(result) 개 이상이어야 함
+    @param	def	NULL 이거나 숫자가 아닌 값의 기본값
+    @return	변환한 row 수. 실패시 FAIL
+*/
+int	tb_postgre_column_integer (PGresult * result, int column, int * values, int def)
+{
+	if (!result || column < 0 || column >= PQnfields(result) || !values)
+		return	FAIL ;
+
+	int	rows = PQntuples(result) ;
+	int	row ;
+
+	for (row = 0; row < rows; row++)
+	{
+		if (PQgetisnull(result, row, column) || tb_parse_int(PQgetvalue(result, row, column), PQgetlength(result, row, column), &values[row]) != SUCCESS)
+			values[row] = def ;
+	}
+
+	return	rows ;
+}
+
+/** @fn int	tb_postgre_column_long (PGresult * result, int column, long * values, long def)
+    @brief	PGresult 의 한 column 전체를 long 으로 변환. PQgetlength 로 길이를 알고 있으므로 strlen 없이 tb_parse_long 으로 바로 변환
+    @param	result	PGresult
+    @param	column	column index. 0부터 시작
+    @param	values	변환한 값 저장할 배열. PQntuples(result) 개 이상이어야 함
+    @param	def	NULL 이거나 숫자가 아닌 값의 기본값
+    @return	변환한 row 수. 실패시 FAIL
+*/
+int	tb_postgre_column_long (PGresult * result, int column, long * values, long def)
+{
+	if (!result || column < 0 || column >= PQnfields(result) || !values)
+		return	FAIL ;
+
+	int	rows = PQntuples(result) ;
+	int	row ;
+
+	for (row = 0; row < rows; row++)
+	{
+		if (PQgetisnull(result, row, column) || tb_parse_long(PQgetvalue(result, row, column), PQgetlength(result, row, column), &values[row]) != SUCCESS)
+			values[row] = def ;
+	}
+
+	return	rows ;
+}
+
+/** @fn int	tb_postgre_column_double (PGresult * result, int column, double * values, double def)
+    @brief	PGresult 의 한 column 전체를 double 로 변환. numeric, float 타입 column 에 사용
+    @param	result	PGresult
+    @param	column	column index. 0부터 시작
+    @param	values	변환한 값 저장할 배열. PQntuples(result) 개 이상이어야 함
+    @param	def	NULL 이거나 숫자가 아닌 값의 기본값
+    @return	변환한 row 수. 실패시 FAIL
+*/
+int	tb_postgre_column_double (PGresult * result, int column, double * values, double def)
+{
+	if (!result || column < 0 || column >= PQnfields(result) || !values)
+		return	FAIL ;
+
+	int	rows = PQntuples(result) ;
+	int	row ;
+
+	for (row = 0; row < rows; row++)
+	{
+		if (PQgetisnull(result, row, column) || tb_parse_double(PQgetvalue(result, row, column), PQgetlength(result, row, column), &values[row]) != SUCCESS)
+			values[row] = def ;
+	}
+
+	return	rows ;
+}
+
 /** @fn apr_array_header_t *	tb_pgresult_to_array (apr_pool_t * pool, PGresult * result)
     @brief	PGresult를 array로 변환
     @param	pool	메모리 할당 풀
@@ -6,153 +6,833 @@
 
 #include "turbo.h"
 #include <http_core.h>
+#include <apr_file_io.h>
+#include <apr_mmap.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <zlib.h>
 
-static	void	request_parse_multipart (request_rec * r, REQUEST_PARSE_T * rp)
+/* multipart body 가 이 크기를 넘으면 임시 파일에 쓰고 mmap 으로 접근. 0 이면 항상 메모리에 읽음 */
+static	apr_off_t	multipart_spill_size = 0 ;
+
+/** @fn void	tb_set_multipart_spill_size (apr_off_t size)
+    @brief	request_params_parse 에서 multipart body 를 임시 파일로 저장할 크기 설정. 설정한 크기를 넘는 upload 는 메모리 대신 mmap 한 임시 파일을 가리킴
+    @param	size	byte 단위 크기. 0 이면 임시 파일 사용하지 않음(기본값)
+*/
+void	tb_set_multipart_spill_size (apr_off_t size)
 {
-	const char *	content_type = apr_table_get(r->headers_in, "Content-Type") ? : "" ;
+	multipart_spill_size = size > 0 ? size : 0 ;
+}
+
+/* 메모리에 읽는 multipart body 최대 크기. 임시 파일로 넘기는 body 에는 적용하지 않음 */
+static	apr_off_t	multipart_body_limit = 104857600 ;
+
+/** @fn void	tb_set_multipart_body_limit (apr_off_t limit)
+    @brief	request_params_parse 에서 메모리에 읽을 multipart body 최대 크기 설정. 넘으면 읽기 실패로 처리함.
+		더 큰 upload 는 tb_set_multipart_spill_size 로 임시 파일에 받음
+    @param	limit	byte 단위 크기. 기본값 100MB
+*/
+void	tb_set_multipart_body_limit (apr_off_t limit)
+{
+	if (limit > 0)
+		multipart_body_limit = limit ;
+}
+
+/* 압축 해제한 request body 최대 크기 */
+static	apr_off_t	inflate_body_limit = 104857600 ;
+
+/** @fn void	tb_set_inflate_body_limit (apr_off_t limit)
+    @brief	Content-Encoding 이 gzip, deflate 인 request body 를 압축 해제할 최대 크기 설정. 넘으면 읽기 실패로 처리함
+    @param	limit	byte 단위 크기. 기본값 100MB
+*/
+void	tb_set_inflate_body_limit (apr_off_t limit)
+{
+	if (limit > 0)
+		inflate_body_limit = limit ;
+}
+
+/* request body 읽기. Content-Encoding 이 gzip, deflate 면 읽는 대로 압축 해제함 */
+typedef struct
+{
+	request_rec *	r ;
+	apr_off_t	length ;	/* body 크기. chunked, 압축된 body 는 알 수 없으므로 -1 */
+	z_stream *	zs ;
+	char *		in ;		/* 압축된 입력 버퍼. HUGE_STRING_LEN 크기 */
+	long		in_n ;
+	int		deflate ;	/* Content-Encoding: deflate */
+	int		eof ;
+} REQUEST_BODY_T ;
+
+static	apr_status_t	request_body_cleanup (void * data)
+{
+	inflateEnd((z_stream *)data) ;
+
+	return	APR_SUCCESS ;
+}
+
+static	voidpf	request_body_zalloc (voidpf opaque, uInt items, uInt size)
+{
+	return	apr_palloc((apr_pool_t *)opaque, items * size) ;
+}
+
+static	void	request_body_zfree (voidpf opaque, voidpf address)
+{
+}
+
+/* body 읽기 준비. 읽을 body 가 없거나 지원하지 않는 Content-Encoding 이면 FAIL */
+static	int	request_body_open (request_rec * r, REQUEST_BODY_T * body)
+{
+	memset(body, 0, sizeof(REQUEST_BODY_T)) ;
+	body->r = r ;
+
+	if (ap_setup_client_block(r, REQUEST_CHUNKED_DECHUNK) || !ap_should_client_block(r))
+		return	FAIL ;
+
+	body->length = r->read_chunked ? -1 : r->remaining ;
+
+	const char *	encoding = apr_table_get(r->headers_in, "Content-Encoding") ;
+	int		window_bits ;
+
+	if (!encoding || !*encoding || !strcasecmp(encoding, "identity"))
+		return	SUCCESS ;
+	else if (!strcasecmp(encoding, "gzip") || !strcasecmp(encoding, "x-gzip"))
+		window_bits = 15 + 16 ;
+	/* deflate 는 zlib 형식이지만 raw deflate 를 보내는 client 도 있으므로 zlib header 가 아니면 raw 로 다시 시도 */
+	else if (! strcasecmp(encoding, "deflate"))
+		window_bits = 15, body->deflate = 1 ;
+	else
+	{
+		TB_LOG_WARN(r, "%s: unsupported Content-Encoding [%s].", __FUNCTION__, encoding) ;
+		return	FAIL ;
+	}
+
+	body->zs = apr_pcalloc(r->pool, sizeof(z_stream)) ;
+	body->zs->zalloc = request_body_zalloc ;
+	body->zs->zfree = request_body_zfree ;
+	body->zs->opaque = r->pool ;
+	if (inflateInit2(body->zs, window_bits) != Z_OK)
+	{
+		TB_LOG_ERROR(r, "%s: inflateInit2 failed.", __FUNCTION__) ;
+		return	FAIL ;
+	}
+	apr_pool_cleanup_register(r->pool, body->zs, request_body_cleanup, apr_pool_cleanup_null) ;
+
+	body->in = apr_palloc(r->pool, HUGE_STRING_LEN) ;
+	body->length = -1 ;
+
+	return	SUCCESS ;
+}
 
+/* ap_get_client_block 과 같이 읽은 크기 반환. body 끝이면 0, 실패시 -1 */
+static	long	request_body_read (REQUEST_BODY_T * body, char * buf, size_t len)
+{
+	z_stream *	zs = body->zs ;
+
+	if (! zs)
+		return	ap_get_client_block(body->r, buf, len) ;
+
+	zs->next_out = (Bytef *)buf ;
+	zs->avail_out = len ;
+
+	while (zs->avail_out == len && !body->eof)
+	{
+		if (! zs->avail_in)
+		{
+			long	n = ap_get_client_block(body->r, body->in, HUGE_STRING_LEN) ;
+			if (n < 0)
+				return	-1 ;
+			if (! n)
+			{
+				TB_LOG_WARN(body->r, "%s: compressed body is truncated.", __FUNCTION__) ;
+				return	-1 ;
+			}
+			zs->next_in = (Bytef *)body->in ;
+			zs->avail_in = body->in_n = n ;
+		}
+
+		int	ret = inflate(zs, Z_NO_FLUSH) ;
+		if (ret == Z_DATA_ERROR && body->deflate)
+		{
+			body->deflate = 0 ;
+			if (inflateReset2(zs, -15) != Z_OK)
+				return	-1 ;
+			zs->next_in = (Bytef *)body->in ;
+			zs->avail_in = body->in_n ;
+			continue ;
+		}
+		if (zs->total_in >= 2)
+			body->deflate = 0 ;
+
+		if (ret == Z_STREAM_END)
+			body->eof = 1 ;
+		else if (ret != Z_OK && ret != Z_BUF_ERROR)
+		{
+			TB_LOG_WARN(body->r, "%s: inflate failed [%d].", __FUNCTION__, ret) ;
+			return	-1 ;
+		}
+
+		if (zs->total_out > inflate_body_limit)
+		{
+			TB_LOG_WARN(body->r, "%s: inflated body exceeds limit [%ld].", __FUNCTION__, (long)inflate_body_limit) ;
+			return	-1 ;
+		}
+	}
+
+	return	len - zs->avail_out ;
+}
+
+/* body 를 읽을 버퍼. realloc 으로 늘리므로 이전 버퍼가 pool 에 남지 않고, r->pool 정리될 때 해제됨 */
+typedef struct
+{
+	char *	data ;
+	size_t	size ;
+} BODY_BUFFER_T ;
+
+static	apr_status_t	body_buffer_cleanup (void * data)
+{
+	free(((BODY_BUFFER_T *)data)->data) ;
+
+	return	APR_SUCCESS ;
+}
+
+/* size byte 를 읽을 수 있게 버퍼 늘리기. 읽은 내용은 유지하고 끝에 NULL 문자 넣을 공간을 남겨둠. 실패시 NULL 반환 */
+static	char *	body_buffer_grow (request_rec * r, BODY_BUFFER_T * buffer, size_t size)
+{
+	char *	data = realloc(buffer->data, size + 1) ;
+	if (! data)
+	{
+		TB_LOG_ERROR(r, "%s: buffer [%ld] alloc failed.", __FUNCTION__, (long)size) ;
+		return	NULL ;
+	}
+
+	if (! buffer->data)
+		apr_pool_cleanup_register(r->pool, buffer, body_buffer_cleanup, apr_pool_cleanup_null) ;
+	buffer->data = data ;
+	buffer->size = size ;
+
+	return	data ;
+}
+
+static	int	multipart_add_part (void * data, MULTIPART_PART_T * part)
+{
+	apr_array_header_t *	parts = (apr_array_header_t *)data ;
+	APR_ARRAY_PUSH(parts, MULTIPART_PART_T *) = part ;
+
+	return	SUCCESS ;
+}
+
+/* 파싱한 part 를 REQUEST_PARSE_T 로 옮기기. file 은 복사하지 않고 body 를 그대로 가리키고 나머지는 query parameter 로 취급함.
+   같은 이름의 field 는 form 과 같이 REQUEST_PARSE_MULTI_VALUE 면 각각 추가하고 아니면 ", " 로 합침 */
+static	void	multipart_collect_parts (request_rec * r, REQUEST_PARSE_T * rp, const char * content, apr_array_header_t * parts, int flags)
+{
+	int	i ;
+	for (i = 0; i < parts->nelts; i++)
+	{
+		MULTIPART_PART_T *	part = APR_ARRAY_IDX(parts, i, MULTIPART_PART_T *) ;
+		const char *		value = content + part->offset ;
+
+		if (! part->key)
+			continue ;
+
+		/* multipart file 아닌 경우에는 query parameter 로 취급함 */
+		if (!part->filename || !*part->filename)
+		{
+			if (!*part->key || !part->data_n)
+				continue ;
+
+			if (flags & REQUEST_PARSE_MULTI_VALUE)
+				apr_table_addn(rp->params, part->key, apr_pstrmemdup(r->pool, value, part->data_n)) ;
+			else
+				apr_table_mergen(rp->params, part->key, apr_pstrmemdup(r->pool, value, part->data_n)) ;
+			continue ;
+		}
+
+		part->data = value ;
+		if (! part->content_type)
+			part->content_type = "" ;
+
+		if (! rp->parts)
+			rp->parts = apr_array_make(r->pool, 2, sizeof(MULTIPART_PART_T *)) ;
+		APR_ARRAY_PUSH(rp->parts, MULTIPART_PART_T *) = part ;
+
+		/* 하위 호환: multipart 에는 마지막 file 을 넣음 */
+		rp->multipart.content_type = part->content_type ;
+		rp->multipart.filename = part->filename ;
+		rp->multipart.key = part->key ;
+		rp->multipart.data = part->data ;
+		rp->multipart.data_n = part->data_n ;
+
+		/* for debug */
+		apr_table_set(rp->params, part->key, part->filename) ;
+	}
+}
+
+/* body 를 임시 파일에 쓰면서 파싱한 후 mmap. 먼저 읽어서 파싱한 content 가 있으면 파일 앞에 씀.
+   파일과 mmap 은 r->pool 정리될 때 같이 정리됨 */
+static	const char *	multipart_spill_body (request_rec * r, REQUEST_PARSE_T * rp, REQUEST_BODY_T * body, MULTIPART_PARSER_T * parser, const char * content)
+{
+	const char *	temp_dir ;
+	apr_file_t *	file ;
+
+	if (apr_temp_dir_get(&temp_dir, r->pool) != APR_SUCCESS)
+		return	NULL ;
+
+	char *	path = apr_pstrcat(r->pool, temp_dir, "/turbo.XXXXXX", NULL) ;
+	if (apr_file_mktemp(&file, path, APR_FOPEN_CREATE | APR_FOPEN_READ | APR_FOPEN_WRITE | APR_FOPEN_EXCL | APR_FOPEN_BINARY | APR_FOPEN_DELONCLOSE, r->pool) != APR_SUCCESS)
+	{
+		TB_LOG_ERROR(r, "%s: temp file [%s] create failed.", __FUNCTION__, path) ;
+		return	NULL ;
+	}
+
+	if (rp->multipart_read_n && apr_file_write_full(file, content, rp->multipart_read_n, NULL) != APR_SUCCESS)
+	{
+		TB_LOG_ERROR(r, "%s: temp file [%s] write failed.", __FUNCTION__, path) ;
+		return	NULL ;
+	}
+
+	char	buf [HUGE_STRING_LEN] ;
+	long	len ;
+	while ((len = request_body_read(body, buf, _N(buf))) > 0)
+	{
+		if (apr_file_write_full(file, buf, len, NULL) != APR_SUCCESS)
+		{
+			TB_LOG_ERROR(r, "%s: temp file [%s] write failed.", __FUNCTION__, path) ;
+			return	NULL ;
+		}
+
+		rp->multipart_read_n += len ;
+		if (tb_multipart_parser_execute(parser, buf, len) != SUCCESS)
+		{
+			TB_LOG_WARN(r, "%s: multipart parse failed at [%ld].", __FUNCTION__, rp->multipart_read_n) ;
+			break ;
+		}
+	}
+
+	if (! rp->multipart_read_n)
+		return	"" ;
+
+	apr_mmap_t *	mm ;
+	if (apr_mmap_create(&mm, file, 0, rp->multipart_read_n, APR_MMAP_READ, r->pool) != APR_SUCCESS)
+	{
+		TB_LOG_ERROR(r, "%s: temp file [%s] mmap failed.", __FUNCTION__, path) ;
+		return	NULL ;
+	}
+
+	return	mm->mm ;
+}
+
+/* body 를 메모리 한 버퍼에 읽으면서 파싱. chunked, 압축된 body 는 크기를 모르므로 버퍼를 두 배씩 늘려가며 읽고
+   spill 크기에 도달하면 그때까지 읽은 내용과 함께 임시 파일로 넘김. multipart_body_limit 을 넘으면 실패 */
+static	const char *	multipart_read_body (request_rec * r, REQUEST_PARSE_T * rp, REQUEST_BODY_T * body, MULTIPART_PARSER_T * parser)
+{
+	BODY_BUFFER_T *	buffer = apr_pcalloc(r->pool, sizeof(BODY_BUFFER_T)) ;
+	long		len ;
+
+	if (! body_buffer_grow(r, buffer, body->length < 0 ? HUGE_STRING_LEN : rp->multipart_size))
+		return	NULL ;
+
+	for (;;)
+	{
+		if (rp->multipart_read_n == buffer->size)
+		{
+			if (body->length >= 0)
+				break ;
+
+			if (multipart_spill_size && buffer->size >= multipart_spill_size)
+				return	multipart_spill_body(r, rp, body, parser, buffer->data) ;
+
+			/* limit 을 넘는지 확인하기 위해 limit + 1 까지 읽음 */
+			if (buffer->size > multipart_body_limit)
+			{
+				TB_LOG_WARN(r, "%s: multipart body exceeds limit [%ld].", __FUNCTION__, (long)multipart_body_limit) ;
+				return	NULL ;
+			}
+
+			size_t	size = buffer->size * 2 ;
+			if (multipart_spill_size && size > multipart_spill_size)
+				size = multipart_spill_size ;
+			if (size > multipart_body_limit)
+				size = multipart_body_limit + 1 ;
+
+			if (! body_buffer_grow(r, buffer, size))
+				return	NULL ;
+		}
+
+		if ((len = request_body_read(body, buffer->data + rp->multipart_read_n, buffer->size - rp->multipart_read_n)) <= 0)
+			break ;
+
+		if (tb_multipart_parser_execute(parser, buffer->data + rp->multipart_read_n, len) != SUCCESS)
+		{
+			TB_LOG_WARN(r, "%s: multipart parse failed at [%ld].", __FUNCTION__, rp->multipart_read_n) ;
+			break ;
+		}
+		rp->multipart_read_n += len ;
+	}
+
+	return	buffer->data ;
+}
+
+static	void	request_parse_multipart (request_rec * r, REQUEST_PARSE_T * rp, int flags)
+{
 	/* Content-Type 헤더에서 구분자를 읽고 이 구분자를 사용하여 body 를 parsing.
 	   header example) Content-Type: multipart/form-data; boundary=----WebKitFormBoundarybkPVQ2XhzZ75QktL"
 	 */
-
-	char *	p = strstr(content_type, "boundary") ;
-	if (! p)
+	const char *	boundary = tb_multipart_boundary(r->pool, apr_table_get(r->headers_in, "Content-Type")) ;
+	if (! boundary)
 		return ;
 
-	char	delimiter[128] ;
-	sscanf(p, "boundary=%[^ \r\n]", delimiter) ;
-
-	if (! *delimiter)
+	REQUEST_BODY_T	body ;
+	if (request_body_open(r, &body) != SUCCESS)
 		return ;
 
-	if (ap_setup_client_block(r, REQUEST_CHUNKED_ERROR) || !ap_should_client_block(r))
+	apr_array_header_t *			parts = apr_array_make(r->pool, 4, sizeof(MULTIPART_PART_T *)) ;
+	MULTIPART_CALLBACK_T			callback = {
+		.part_end = multipart_add_part,
+		.digests = (flags & REQUEST_PARSE_DIGEST_MD5 ? MULTIPART_DIGEST_MD5 : 0) | (flags & REQUEST_PARSE_DIGEST_SHA256 ? MULTIPART_DIGEST_SHA256 : 0),
+	} ;
+	MULTIPART_PARSER_T *			parser = tb_multipart_parser_create(r->pool, boundary, &callback, parts) ;
+	if (! parser)
 		return ;
 
-	char *		content = apr_pcalloc(r->pool, r->remaining)  ;
-	size_t		content_n = 0 ;
-	char         	buf[4096] ;
-	apr_off_t    	len ;
+	/* part 를 body 안의 위치로 가리키기 위해 body 전체를 한 버퍼(큰 경우에는 mmap 한 임시 파일)에 읽음.
+	   메모리를 고정하려면 tb_request_multipart_parse 사용 */
+	rp->multipart_size = body.length < 0 ? 0 : body.length ;
 
-	/* request body 읽기 */
-	rp->multipart_size = r->remaining ;
-	while((len = ap_get_client_block(r, buf, _N(buf) - 1)) > 0)
+	const char *	content ;
+	if (multipart_spill_size && body.length > multipart_spill_size)
+		content = multipart_spill_body(r, rp, &body, parser, NULL) ;
+	else if (body.length > multipart_body_limit)
 	{
-		memcpy(content + content_n, buf, len) ;
-		content_n += len ;
+		TB_LOG_WARN(r, "%s: multipart body [%ld] exceeds limit [%ld].", __FUNCTION__, (long)body.length, (long)multipart_body_limit) ;
+		return ;
 	}
-	rp->multipart_read_n = content_n ;
+	else
+		content = multipart_read_body(r, rp, &body, parser) ;
+
+	if (! content)
+		return ;
+
+	/* chunked, 압축된 body 는 다 읽은 후에 크기를 알 수 있음 */
+	if (body.length < 0)
+		rp->multipart_size = rp->multipart_read_n ;
 
 	/* 경고 */
 	if (rp->multipart_read_n < rp->multipart_size)
 		TB_LOG_WARN(r, "%s: multipart read [%ld/%ld] failed.", __FUNCTION__, rp->multipart_read_n, rp->multipart_size) ;
+	else if (tb_multipart_parser_finish(parser) != SUCCESS)
+		TB_LOG_WARN(r, "%s: multipart body is not terminated.", __FUNCTION__) ;
 
-	char *	s = content ;
-	int	delimiter_n = strlen(delimiter) ;
-	char	key [128] ;
-	char	value [512] ;
-	char	name [256] ;
-	char	filename [256] ;
-	char	type [128] ;
-	int	newline_n ;
-
-	/* binary 데이터여서 strstr 사용하면 중간에 잘릴 수 있어서 tb_memstr 사용함 */
-	while ((p = tb_memstr(s, content_n - (s - content), delimiter)))
+	multipart_collect_parts(r, rp, content, parts, flags) ;
+
+	return ;
+}
+
+/** @fn const MULTIPART_PART_T *	tb_request_part (const REQUEST_PARSE_T * rp, const char * key)
+    @brief	request_params_parse 로 파싱한 multipart file 중에서 key 로 찾기
+    @param	rp	request_params_parse 결과
+    @param	key	form field 이름
+    @return	key 가 같은 첫번째 file part. 없으면 NULL 반환
+*/
+const MULTIPART_PART_T *	tb_request_part (const REQUEST_PARSE_T * rp, const char * key)
+{
+	if (!rp || !rp->parts || !key)
+		return	NULL ;
+
+	int	i ;
+	for (i = 0; i < rp->parts->nelts; i++)
+	{
+		const MULTIPART_PART_T *	part = APR_ARRAY_IDX(rp->parts, i, MULTIPART_PART_T *) ;
+		if (! strcmp(part->key, key))
+			return	part ;
+	}
+
+	return	NULL ;
+}
+
+/** @fn int	tb_request_multipart_parse (request_rec * r, const MULTIPART_CALLBACK_T * callback, void * data)
+    @brief	multipart body 를 버퍼링하지 않고 읽는 대로 파싱하여 part 별로 callback 호출. upload 크기와 관계없이 메모리 사용량이 일정함
+    @param	r		request_rec
+    @param	callback	part 별로 호출할 callback 목록
+    @param	data		callback 에 전달할 사용자 데이터
+    @return	마지막 boundary 까지 파싱 성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_request_multipart_parse (request_rec * r, const MULTIPART_CALLBACK_T * callback, void * data)
+{
+	const char *	boundary = tb_multipart_boundary(r->pool, apr_table_get(r->headers_in, "Content-Type")) ;
+	if (! boundary)
+		return	FAIL ;
+
+	MULTIPART_PARSER_T *	parser = tb_multipart_parser_create(r->pool, boundary, callback, data) ;
+	if (! parser)
+		return	FAIL ;
+
+	REQUEST_BODY_T	body ;
+	if (request_body_open(r, &body) != SUCCESS)
+		return	FAIL ;
+
+	char	buf [HUGE_STRING_LEN] ;
+	long	len ;
+
+	while ((len = request_body_read(&body, buf, _N(buf))) > 0)
+	{
+		if (tb_multipart_parser_execute(parser, buf, len) != SUCCESS)
+		{
+			TB_LOG_WARN(r, "%s: multipart parse failed.", __FUNCTION__) ;
+			return	FAIL ;
+		}
+	}
+
+	if (len < 0)
+	{
+		TB_LOG_WARN(r, "%s: multipart read failed.", __FUNCTION__) ;
+		return	FAIL ;
+	}
+
+	return	tb_multipart_parser_finish(parser) ;
+}
+
+typedef struct
+{
+	char *		key ;
+	size_t		key_n ;
+	char *		value ;
+	size_t		value_n ;
+	int		decoded ;
+} QUERY_PARAM_T ;
+
+/* 지연 파싱한 GET 파라미터. r->args 안의 위치만 기록하고 value 는 처음 읽을 때 unescape */
+struct	QUERY_T
+{
+	apr_array_header_t *	params ;
+} ;
+
+static	int	hex_value (int c)
+{
+	return	c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10 ;
+}
+
+/* x-www-form-urlencoded 문자열을 그 자리에서 unescape. '+' 는 공백으로 바꾸고 %00 은 그대로 둠
+   unescape 한 길이 반환 */
+static	size_t	unescape_form (char * s, size_t n)
+{
+	char *		d = s ;
+	const char *	p = s ;
+	const char *	e = s + n ;
+
+	while (p < e)
+	{
+		if (*p == '+')
+		{
+			*d++ = ' ' ;
+			p++ ;
+		}
+		else if (*p == '%' && e - p > 2 && isxdigit(p[1]) && isxdigit(p[2]) && (p[1] != '0' || p[2] != '0'))
+		{
+			*d++ = hex_value(p[1]) << 4 | hex_value(p[2]) ;
+			p += 3 ;
+		}
+		else
+			*d++ = *p++ ;
+	}
+
+	return	d - s ;
+}
+
+/* GET 파라미터 위치만 기록. key 는 escape 된 경우에만 바로 unescape 함 */
+static	QUERY_T *	query_index (apr_pool_t * pool, char * args)
+{
+	QUERY_T *	query = apr_palloc(pool, sizeof(QUERY_T)) ;
+	char *		p = args ;
+
+	query->params = apr_array_make(pool, 8, sizeof(QUERY_PARAM_T)) ;
+
+	while (p && *p)
+	{
+		char *	e = strchr(p, '&') ? : p + strlen(p) ;
+		char *	eq = memchr(p, '=', e - p) ;
+
+		if (e > p)
+		{
+			QUERY_PARAM_T *	param = apr_array_push(query->params) ;
+			param->key = p ;
+			param->key_n = (eq ? eq : e) - p ;
+			param->value = eq ? eq + 1 : e ;
+			param->value_n = eq ? e - eq - 1 : 0 ;
+			param->decoded = 0 ;
+
+			if (memchr(param->key, '%', param->key_n) || memchr(param->key, '+', param->key_n))
+				param->key_n = unescape_form(param->key, param->key_n) ;
+		}
+
+		p = *e ? e + 1 : NULL ;
+	}
+
+	return	query ;
+}
+
+static	const char *	query_param_value (QUERY_PARAM_T * param)
+{
+	if (! param->decoded)
+	{
+		/* value 뒤의 '&' 자리에 NULL 문자를 넣어도 다른 파라미터에 영향 없음 */
+		param->value_n = unescape_form(param->value, param->value_n) ;
+		param->value[param->value_n] = '\0' ;
+		param->decoded = 1 ;
+	}
+
+	return	param->value ;
+}
+
+/** @fn const char *	tb_query_string (QUERY_T * query, const char * name, const char * def)
+    @brief	지연 파싱한 GET 파라미터 읽기. value 는 처음 읽을 때 unescape 함
+    @param	query	REQUEST_PARSE_T 의 query
+    @param	name	파라미터 이름. 대소문자 구분하지 않음
+    @param	def	기본값
+    @return	같은 이름의 파라미터가 여러 개인 경우 첫번째 값. 없으면 def
+*/
+const char *	tb_query_string (QUERY_T * query, const char * name, const char * def)
+{
+	if (!query || !name)
+		return	def ;
+
+	size_t	name_n = strlen(name) ;
+	int	i ;
+
+	for (i = 0; i < query->params->nelts; i++)
+	{
+		QUERY_PARAM_T *	param = &APR_ARRAY_IDX(query->params, i, QUERY_PARAM_T) ;
+		if (param->key_n == name_n && !strncasecmp(param->key, name, name_n))
+			return	query_param_value(param) ;
+	}
+
+	return	def ;
+}
+
+/** @fn int	tb_query_integer (QUERY_T * query, const char * name, int def)
+    @brief	지연 파싱한 GET 파라미터에서 integer 값 읽기
+    @param	query	REQUEST_PARSE_T 의 query
+    @param	name	파라미터 이름
+    @param	def	기본값
+    @return	integer value
+*/
+int	tb_query_integer (QUERY_T * query, const char * name, int def)
+{
+	return	tb_atoi(tb_query_string(query, name, NULL), def) ;
+}
+
+/** @fn apr_array_header_t *	tb_query_values (apr_pool_t * pool, QUERY_T * query, const char * name)
+    @brief	지연 파싱한 GET 파라미터에서 같은 이름의 값을 모두 읽기. e.g.) ids=1&ids=2
+    @param	pool	메모리 할당 풀
+    @param	query	REQUEST_PARSE_T 의 query
+    @param	name	파라미터 이름. 대소문자 구분하지 않음
+    @return	값 목록. const char * array 이며 없으면 빈 array
+*/
+apr_array_header_t *	tb_query_values (apr_pool_t * pool, QUERY_T * query, const char * name)
+{
+	apr_array_header_t *	values = apr_array_make(pool, 4, sizeof(const char *)) ;
+	if (!query || !name)
+		return	values ;
+
+	size_t	name_n = strlen(name) ;
+	int	i ;
+
+	for (i = 0; i < query->params->nelts; i++)
 	{
-		s = p + delimiter_n ;
+		QUERY_PARAM_T *	param = &APR_ARRAY_IDX(query->params, i, QUERY_PARAM_T) ;
+		if (param->key_n == name_n && !strncasecmp(param->key, name, name_n))
+			APR_ARRAY_PUSH(values, const char *) = query_param_value(param) ;
+	}
+
+	return	values ;
+}
+
+/** @fn const char *	tb_param_string (REQUEST_PARSE_T * rp, const char * name, const char * def)
+    @brief	파라미터 문자열 읽기. 지연 파싱한 GET 파라미터를 먼저 찾고 없으면 params 에서 찾음
+    @param	rp	request_params_parse 결과
+    @param	name	파라미터 이름
+    @param	def	기본값
+    @return	문자열
+*/
+const char *	tb_param_string (REQUEST_PARSE_T * rp, const char * name, const char * def)
+{
+	if (! rp)
+		return	def ;
+
+	const char *	val = tb_query_string(rp->query, name, NULL) ;
+	if (val)
+		return	val ;
+
+	return	tb_table_string(rp->params, name, def) ;
+}
 
-		*key = '\0' ;
-		*value = '\0' ;
-		*type = '\0' ;
-		*filename = '\0' ;
+/** @fn int	tb_param_integer (REQUEST_PARSE_T * rp, const char * name, int def)
+    @brief	파라미터 integer 값 읽기. 지연 파싱한 GET 파라미터를 먼저 찾고 없으면 params 에서 찾음
+    @param	rp	request_params_parse 결과
+    @param	name	파라미터 이름
+    @param	def	기본값
+    @return	integer value
+*/
+int	tb_param_integer (REQUEST_PARSE_T * rp, const char * name, int def)
+{
+	return	tb_atoi(tb_param_string(rp, name, NULL), def) ;
+}
 
-		do {
-			newline_n = 0 ;
-			while (*s == '\r' || *s == '\n')
+/** @fn apr_array_header_t *	tb_param_values (apr_pool_t * pool, REQUEST_PARSE_T * rp, const char * name)
+    @brief	같은 이름의 파라미터 값을 모두 읽기. 지연 파싱한 GET 파라미터를 먼저 찾고 없으면 params 에서 찾음.
+		REQUEST_PARSE_MULTI_VALUE 없이 파싱한 경우 params 의 값은 ", " 로 합쳐진 하나의 값임
+    @param	pool	메모리 할당 풀
+    @param	rp	request_params_parse 결과
+    @param	name	파라미터 이름
+    @return	값 목록. const char * array 이며 없으면 빈 array
+*/
+apr_array_header_t *	tb_param_values (apr_pool_t * pool, REQUEST_PARSE_T * rp, const char * name)
+{
+	apr_array_header_t *	values = tb_query_values(pool, rp ? rp->query : NULL, name) ;
+	if (values->nelts || !rp)
+		return	values ;
+
+	return	tb_table_values(pool, rp->params, name) ;
+}
+
+/* x-www-form-urlencoded, JSON body 최대 크기 */
+static	apr_off_t	form_body_limit = 2097152 ;
+
+/** @fn void	tb_set_form_body_limit (apr_off_t limit)
+    @brief	request_params_parse 에서 읽을 x-www-form-urlencoded, JSON body 최대 크기 설정
+    @param	limit	byte 단위 크기. 기본값 2MB
+*/
+void	tb_set_form_body_limit (apr_off_t limit)
+{
+	if (limit > 0)
+		form_body_limit = limit ;
+}
+
+/* request body 를 한 버퍼에 읽기. 끝에 NULL 문자 넣을 공간을 남겨둠. limit 넘거나 실패시 NULL 반환.
+   chunked, 압축된 body 는 크기를 모르므로 버퍼를 두 배씩 늘려가며 읽음 */
+static	char *	request_read_body (request_rec * r, apr_off_t limit, size_t * body_n)
+{
+	REQUEST_BODY_T	reader ;
+	if (request_body_open(r, &reader) != SUCCESS)
+		return	NULL ;
+
+	if (reader.length > limit)
+	{
+		TB_LOG_WARN(r, "%s: request body [%ld] exceeds limit [%ld].", __FUNCTION__, (long)reader.length, (long)limit) ;
+		return	NULL ;
+	}
+
+	BODY_BUFFER_T *	buffer = apr_pcalloc(r->pool, sizeof(BODY_BUFFER_T)) ;
+	size_t		n = 0 ;
+	long		len = 0 ;
+
+	if (! body_buffer_grow(r, buffer, reader.length < 0 ? HUGE_STRING_LEN : reader.length))
+		return	NULL ;
+
+	for (;;)
+	{
+		if (n == buffer->size)
+		{
+			if (reader.length >= 0)
+				break ;
+
+			/* limit 을 넘는지 확인하기 위해 limit + 1 까지 읽음 */
+			if (n > limit)
 			{
-				if (*s == '\n')
-					newline_n++ ;
-				s++ ;
+				TB_LOG_WARN(r, "%s: request body exceeds limit [%ld].", __FUNCTION__, (long)limit) ;
+				return	NULL ;
 			}
 
-			if (newline_n > 1)
-			{
-				/* multipart file */
-				if (*filename)
-				{
-					rp->multipart.content_type = apr_pstrdup(r->pool, type) ;
-					rp->multipart.filename = apr_pstrdup(r->pool, filename) ;
-					rp->multipart.key = apr_pstrdup(r->pool, key) ;
-					rp->multipart.data = s ;
-
-					p = tb_memstr(s, content_n - (s - content), delimiter) ;
-					if (p)
-					{
-						rp->multipart.data_n = p - s ;
-						s = p ;
-					}
-					else
-					{
-						rp->multipart.data_n = content_n - (s - content) ;
-						s += rp->multipart.data_n ;
-					}
-
-					/* for debug */
-					apr_table_set(rp->params, key, filename) ;
-					break ;
-				}
+			if (! body_buffer_grow(r, buffer, buffer->size * 2 > limit ? limit + 1 : buffer->size * 2))
+				return	NULL ;
+		}
 
-				/* multipart file 아닌 경우에는 query parameter 로 취급함 */
-				char *	e = strstr(s, delimiter) ;
-				if (e)
-				{
-					while (*e != '\r' && *e != '\n')
-						e-- ;
+		if ((len = request_body_read(&reader, buffer->data + n, buffer->size - n)) <= 0)
+			break ;
+		n += len ;
+	}
 
-					while (*e == '\r' || *e == '\n')
-						e-- ;
-					e++ ;
+	if (len < 0 || (reader.length >= 0 && n < buffer->size))
+		TB_LOG_WARN(r, "%s: request body read [%ld/%ld] failed.", __FUNCTION__, n, buffer->size) ;
 
-					*e = '\0' ;
-					tb_strncopy(value, s, _N(value)) ;
-				}
-				else
-					*value = '\0' ;
+	if (n > limit)
+	{
+		TB_LOG_WARN(r, "%s: request body exceeds limit [%ld].", __FUNCTION__, (long)limit) ;
+		return	NULL ;
+	}
 
-				if (strstr(value, delimiter))
-					*value = '\0' ;
+	char *	body = buffer->data ;
+	body[n] = '\0' ;
+	*body_n = n ;
 
-				if (*key && *value)
-					apr_table_set(rp->params, key, value) ;
-			}
-			else
-			{
-				if (sscanf(s, "%[^:]:%[^\r\n]", name, buf) < 2)
-					break ;
+	return	body ;
+}
 
-				s += strlen(name) + strlen(buf) + 1 ;
+/* x-www-form-urlencoded body 를 읽은 버퍼 안에서 그대로 unescape 하고 params 는 버퍼를 가리킴 */
+static	void	request_parse_form (request_rec * r, REQUEST_PARSE_T * rp, int flags)
+{
+	size_t	body_n ;
+	char *	body = request_read_body(r, form_body_limit, &body_n) ;
+	if (! body)
+		return ;
 
-				if (! strcmp(name, "Content-Disposition"))
-				{
-					if ((p = strstr(buf, "filename=")))
-						sscanf(p, "filename=\"%[^\"]\"", filename) ;
+	char *	p = body ;
+	char *	e = body + body_n ;
 
-					if ((p = strstr(buf, "name=")))
-						sscanf(p, "name=\"%[^\"]\"", key) ;
-				}
-				else if (! strcmp(name, "Content-Type"))
-				{
-					p = buf ;
-					while (*p && *p == ' ')
-						p++ ;
-					strcpy(type, p) ;
-				}
-			}
-		} while (newline_n < 2) ;
+	while (p < e)
+	{
+		char *	amp = memchr(p, '&', e - p) ? : e ;
+		char *	eq = memchr(p, '=', amp - p) ;
+		char *	key = p ;
+		char *	value = eq ? eq + 1 : amp ;
+
+		/* key, value 끝에 NULL 문자 넣기. unescape 하면 짧아지므로 '=', '&' 자리를 넘지 않음 */
+		key[unescape_form(key, (eq ? eq : amp) - key)] = '\0' ;
+		value[unescape_form(value, amp - value)] = '\0' ;
+
+		if (*key && (flags & REQUEST_PARSE_MULTI_VALUE))
+			apr_table_addn(rp->params, key, value) ;
+		else if (*key)
+			apr_table_mergen(rp->params, key, value) ;
+
+		p = amp + 1 ;
 	}
+}
 
-	return ;
+/* JSON body 를 읽은 버퍼 안에서 그대로 파싱. 최상위 object 의 문자열, 숫자, boolean 멤버는 params 에도 추가.
+   REQUEST_PARSE_MULTI_VALUE 인 경우 멤버가 array 면 array 의 문자열, 숫자, boolean 값을 같은 key 로 모두 추가 */
+static	void	request_parse_json (request_rec * r, REQUEST_PARSE_T * rp, int flags)
+{
+	size_t	body_n ;
+	char *	body = request_read_body(r, form_body_limit, &body_n) ;
+	if (! body)
+		return ;
+
+	rp->json = tb_json_parse(r->pool, body, body_n) ;
+	if (! rp->json)
+	{
+		TB_LOG_WARN(r, "%s: invalid JSON body.", __FUNCTION__) ;
+		return ;
+	}
+
+	const JSON_NODE_T *	root = tb_json_root(rp->json) ;
+	const JSON_NODE_T *	node ;
+	if (root->type != JSON_OBJECT)
+		return ;
+
+	for (node = tb_json_child(rp->json, root); node; node = tb_json_next(rp->json, node))
+	{
+		if (node->type != JSON_NULL && node->type != JSON_ARRAY && node->type != JSON_OBJECT)
+			apr_table_setn(rp->params, node->key, node->value) ;
+		else if (node->type == JSON_ARRAY && (flags & REQUEST_PARSE_MULTI_VALUE))
+		{
+			const JSON_NODE_T *	item ;
+			for (item = tb_json_child(rp->json, node); item; item = tb_json_next(rp->json, item))
+			{
+				if (item->type != JSON_NULL && item->type != JSON_ARRAY && item->type != JSON_OBJECT)
+					apr_table_addn(rp->params, node->key, item->value) ;
+			}
+		}
+	}
 }
 
 /** @fn REQUEST_PARSE_T		request_params_parse (request_rec * r)
@@ -161,6 +841,22 @@ static	void	request_parse_multipart (request_rec * r, REQUEST_PARSE_T * rp)
     @return	파싱한 REQUEST_PARSE_T
 */
 REQUEST_PARSE_T		request_params_parse (request_rec * r)
+{
+	return	request_params_parse_ex(r, 0) ;
+}
+
+/** @fn REQUEST_PARSE_T		request_params_parse_ex (request_rec * r, int flags)
+    @brief	GET, POST, multipart 파라미터 파싱. flags 로 파싱 방법 지정
+    @param	r	request_rec
+    @param	flags	REQUEST_PARSE_LAZY_QUERY: GET 파라미터를 params 에 넣지 않고 위치만 기록. tb_query_*, tb_param_* 로 읽을 때 unescape 함.
+			x-www-form-urlencoded POST 는 body 를 한 번 읽어서 그 자리에서 unescape 하고 params 는 body 를 가리킴.
+			application/json POST 는 rp.json 에 파싱하고 최상위 object 의 문자열, 숫자, boolean 멤버를 params 에 추가.
+			Content-Encoding 이 gzip, deflate 인 body 는 읽는 대로 압축 해제함.
+			REQUEST_PARSE_DIGEST_MD5, REQUEST_PARSE_DIGEST_SHA256: multipart file 을 받으면서 digest 를 계산해서 part 에 저장.
+			REQUEST_PARSE_MULTI_VALUE: 같은 이름의 파라미터를 ", " 로 합치지 않고 각각 추가. tb_param_values 로 읽음
+    @return	파싱한 REQUEST_PARSE_T
+*/
+REQUEST_PARSE_T		request_params_parse_ex (request_rec * r, int flags)
 {
 	REQUEST_PARSE_T	rp = { .params = apr_table_make(r->pool, 4) } ;
 	char *		query_string = r->args ;
@@ -169,7 +865,9 @@ REQUEST_PARSE_T		request_params_parse (request_rec * r)
 	char *		p ;
 
 	/* GET */
-	while (query_string && (param_value=strsep(&query_string, "&")))
+	if (flags & REQUEST_PARSE_LAZY_QUERY)
+		rp.query = query_index(r->pool, query_string) ;
+	else while (query_string && (param_value=strsep(&query_string, "&")))
 	{
 		param_name = strsep(&param_value, "=") ;
 		ap_unescape_url(param_name) ;
@@ -179,37 +877,23 @@ REQUEST_PARSE_T		request_params_parse (request_rec * r)
 			ap_unescape_url(param_value) ;
 		}
 		else	param_value = "" ;
-		apr_table_mergen(rp.params, param_name, param_value) ;
+
+		if (flags & REQUEST_PARSE_MULTI_VALUE)
+			apr_table_addn(rp.params, param_name, param_value) ;
+		else
+			apr_table_mergen(rp.params, param_name, param_value) ;
 	}
 
 	/* POST */
 	const char *	content_type = apr_table_get(r->headers_in, "Content-Type") ? : "" ;
 	if (! strncmp(content_type, "application/x-www-form-urlencoded", 33))
-	{
-		apr_array_header_t *	post = NULL ;
-		int			res = ap_parse_form_data(r, NULL, &post, -1, 2097152) ;
-		if (res != OK || !post) return rp ;
-
-		char *			buffer ;
-		apr_off_t		len ;
-		apr_size_t		size ;
-		ap_form_pair_t *	pair ;
-
-		while (! apr_is_empty_array(post))
-		{
-			pair = (ap_form_pair_t *)apr_array_pop(post) ;
-			apr_brigade_length(pair->value, 1, &len) ;
-			size = (apr_size_t)len ;
-			buffer = apr_palloc(r->pool, size + 1) ;
-			apr_brigade_flatten(pair->value, buffer, &size) ;
-			buffer[len] = '\0' ;
-
-			apr_table_mergen(rp.params, pair->name, buffer) ;
-		}
-	}
+		request_parse_form(r, &rp, flags) ;
+	/* JSON */
+	else if (! strncmp(content_type, "application/json", 16))
+		request_parse_json(r, &rp, flags) ;
 	/* multipart */
 	else if (! strncmp(content_type, "multipart/form-data", 19))
-		request_parse_multipart(r, &rp) ;
+		request_parse_multipart(r, &rp, flags) ;
 
 	return	rp ;
 }
@@ -218,7 +902,7 @@ REQUEST_PARSE_T		request_params_parse (request_rec * r)
     @brief	Java Spring 스타일 URL 매칭 여부 확인하고 매칭시 파라미터 추가
     @param	r		request_rec.
     @param	input_uri	입력한 URI. 일반적으로 r->args 전달하면 됨
-    @param	uri		매칭 확인 URI. {} 로 변수 지정하고 파라미터로 뽑을 수 있으며 .json 도 허용함
+    @param	uri		매칭 확인 URI. {} 로 변수 지정하고 파라미터로 뽑을 수 있으며 .json 도 허용함. {id:int} 처럼 지정하면 정수만 매칭함
     @param	params		{} 매칭시 파라미터 추가할 table
     @return	매칭시 SUCCESS, 매칭 실패시 FAIL
 */
@@ -265,6 +949,27 @@ int	tb_match_uri (request_rec * r, const char * input_uri, const char * uri, apr
 			}
 			else	return	FAIL ;
 
+			/* {key:int} 인 경우 정수만 허용. 타입은 int, str 만 지원하고 tb_route_add 와 같이 그 외는 실패 처리 */
+			if ((k = strchr(key, ':')))
+			{
+				*k++ = '\0' ;
+				if (! strcmp(k, "int"))
+				{
+					v = value + (*value == '-') ;
+					if (! isdigit((unsigned char)*v))
+						return	FAIL ;
+					while (isdigit((unsigned char)*v))
+						v++ ;
+					if (*v && strcmp(v, ".json"))
+						return	FAIL ;
+				}
+				else if (strcmp(k, "str"))
+				{
+					TB_LOG_WARN(r, "%s: unknown placeholder type [%s] in [%s].", __FUNCTION__, k, uri) ;
+					return	FAIL ;
+				}
+			}
+
 			if (0) TB_LOG_ERROR(r, "%s: key: [%s] value: [%s]", __FUNCTION__, key, value) ;
 
 			if (params)
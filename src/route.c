@@ -0,0 +1,309 @@
+//vim:ts=8
+
+/** @file route.c
+    Java Spring 스타일 URI 패턴을 segment trie 로 컴파일해서 한 번에 매칭하는 route table
+*/
+
+#include "turbo.h"
+
+#include <limits.h>
+
+typedef struct ROUTE_NODE_T
+{
+	const char *		segment ;	/* literal segment 또는 {} 변수 이름 */
+	size_t			segment_n ;
+	int			var ;		/* 1이면 {} 변수 segment */
+	int			type ;		/* {} 변수 타입. ROUTE_TYPE_STRING, ROUTE_TYPE_INTEGER */
+	int			id ;		/* 이 node 에서 끝나는 route id. 없으면 FAIL */
+
+	struct ROUTE_NODE_T *	child ;
+	struct ROUTE_NODE_T *	next ;
+} ROUTE_NODE_T ;
+
+struct	ROUTE_TABLE_T
+{
+	apr_pool_t *		pool ;
+	ROUTE_NODE_T *		root ;
+} ;
+
+static	ROUTE_NODE_T *	route_node_make (apr_pool_t * pool, const char * segment, size_t segment_n, int var, int type)
+{
+	ROUTE_NODE_T *	node = apr_pcalloc(pool, sizeof(ROUTE_NODE_T)) ;
+	node->segment = apr_pstrmemdup(pool, segment, segment_n) ;
+	node->segment_n = segment_n ;
+	node->var = var ;
+	node->type = type ;
+	node->id = FAIL ;
+
+	return	node ;
+}
+
+/** @fn ROUTE_TABLE_T *	tb_route_table_make (apr_pool_t * pool)
+    @brief	route table 생성. child init 에서 한 번 만들고 tb_route_add 로 URI 패턴 등록
+    @param	pool	메모리 할당 풀. route table 을 사용하는 동안 유지되어야 함
+    @return	생성한 route table
+*/
+ROUTE_TABLE_T *	tb_route_table_make (apr_pool_t * pool)
+{
+	ROUTE_TABLE_T *	table = apr_pcalloc(pool, sizeof(ROUTE_TABLE_T)) ;
+	table->pool = pool ;
+	table->root = route_node_make(pool, "", 0, 0, ROUTE_TYPE_STRING) ;
+
+	return	table ;
+}
+
+/** @fn int	tb_route_add (ROUTE_TABLE_T * table, const char * uri, int id)
+    @brief	route table 에 URI 패턴 등록
+    @param	table	route table
+    @param	uri	URI 패턴. tb_match_uri 와 같이 {} 로 변수 지정. {} 변수는 '/' 사이의 segment 전체여야 함.
+			{id:int} 처럼 타입 지정하면 매칭하면서 검사, 변환함. 타입은 int, str 이고 생략하면 str
+    @param	id	매칭시 반환할 route id. 0 이상이어야 함
+    @return	성공시 SUCCESS, 패턴이 잘못됐거나 이미 등록된 패턴인 경우 FAIL
+*/
+int	tb_route_add (ROUTE_TABLE_T * table, const char * uri, int id)
+{
+	if (!table || !uri || id < 0)
+		return	FAIL ;
+
+	ROUTE_NODE_T *	node = table->root ;
+	const char *	s = uri ;
+
+	for (;;)
+	{
+		const char *	e = strchr(s, '/') ? : s + strlen(s) ;
+		const char *	segment = s ;
+		size_t		segment_n = e - s ;
+		int		var = 0 ;
+		int		type = ROUTE_TYPE_STRING ;
+
+		if (segment_n && *segment == '{')
+		{
+			if (segment[segment_n - 1] != '}' || segment_n < 3)
+				return	FAIL ;
+
+			segment++ ;
+			segment_n -= 2 ;
+			var = 1 ;
+
+			/* {name:type} */
+			const char *	colon = memchr(segment, ':', segment_n) ;
+			if (colon)
+			{
+				size_t	type_n = segment + segment_n - colon - 1 ;
+				if (type_n == 3 && !strncmp(colon + 1, "int", 3))
+					type = ROUTE_TYPE_INTEGER ;
+				else if (type_n != 3 || strncmp(colon + 1, "str", 3))
+					return	FAIL ;
+
+				segment_n = colon - segment ;
+				if (! segment_n)
+					return	FAIL ;
+			}
+		}
+
+		if (memchr(segment, '{', segment_n) || memchr(segment, '}', segment_n))
+			return	FAIL ;
+
+		/* 같은 segment 의 child 가 있으면 공유 */
+		ROUTE_NODE_T **	link = &node->child ;
+		while (*link && !((*link)->var == var && (*link)->type == type && (*link)->segment_n == segment_n && !memcmp((*link)->segment, segment, segment_n)))
+			link = &(*link)->next ;
+
+		if (! *link)
+			*link = route_node_make(table->pool, segment, segment_n, var, type) ;
+		node = *link ;
+
+		if (! *e)
+			break ;
+		s = e + 1 ;
+	}
+
+	if (node->id != FAIL)
+		return	FAIL ;
+
+	node->id = id ;
+
+	return	SUCCESS ;
+}
+
+/* literal segment 비교. 마지막 segment 는 .json 붙은 경우도 허용 */
+static	int	route_segment_equal (const ROUTE_NODE_T * node, const char * s, size_t segment_n, int last)
+{
+	if (node->segment_n == segment_n && !memcmp(node->segment, s, segment_n))
+		return	1 ;
+
+	return	last && node->segment_n + 5 == segment_n && !memcmp(s + node->segment_n, ".json", 5) && !memcmp(node->segment, s, node->segment_n) ;
+}
+
+/* {id:int} 변수 변환. 마지막 segment 는 .json 붙은 경우도 허용 */
+static	int	route_parse_integer (const char * s, size_t n, int last, long * value)
+{
+	const char *	e = s + n ;
+	int		negative = 0 ;
+	unsigned long	v = 0 ;
+
+	if (last && n > 5 && !memcmp(e - 5, ".json", 5))
+		e -= 5 ;
+
+	if (s < e && *s == '-')
+		negative = 1, s++ ;
+
+	if (s == e)
+		return	FAIL ;
+
+	for (; s < e; s++)
+	{
+		unsigned int	d = (unsigned char)*s - '0' ;
+		if (d > 9 || v > ((unsigned long)LONG_MAX + negative - d) / 10)
+			return	FAIL ;
+		v = v * 10 + d ;
+	}
+
+	*value = negative ? (long)(0 - v) : (long)v ;
+
+	return	SUCCESS ;
+}
+
+/* segment 단위로 trie 탐색. literal child 를 {} 변수보다 먼저 시도하고 실패하면 다음 후보로 되돌아감.
+   {} 변수는 tb_match_uri 와 같이 .json 까지 포함해서 읽음 */
+static	int	route_match_node (const ROUTE_NODE_T * node, const char * s, const char * e, ROUTE_CAPTURE_T * captures, int * captures_n)
+{
+	const char *	segment_e = memchr(s, '/', e - s) ? : e ;
+	size_t		segment_n = segment_e - s ;
+	const ROUTE_NODE_T *	child ;
+	int		pass ;
+	int		id ;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		for (child = node->child; child; child = child->next)
+		{
+			if (child->var != pass)
+				continue ;
+
+			if (! child->var && !route_segment_equal(child, s, segment_n, segment_e == e))
+				continue ;
+
+			int	n = *captures_n ;
+			if (child->var)
+			{
+				if (n >= ROUTE_CAPTURE_MAX)
+					continue ;
+
+				captures[n].name = child->segment ;
+				captures[n].type = child->type ;
+				captures[n].value = s ;
+				captures[n].value_n = segment_n ;
+				captures[n].integer = 0 ;
+
+				/* 타입이 맞지 않으면 다음 후보로 */
+				if (child->type == ROUTE_TYPE_INTEGER && route_parse_integer(s, segment_n, segment_e == e, &captures[n].integer) != SUCCESS)
+					continue ;
+
+				*captures_n = n + 1 ;
+			}
+
+			if (segment_e == e)
+				id = child->id ;
+			else
+				id = route_match_node(child, segment_e + 1, e, captures, captures_n) ;
+
+			if (id != FAIL)
+				return	id ;
+
+			*captures_n = n ;
+		}
+	}
+
+	return	FAIL ;
+}
+
+/** @fn int	tb_route_match_typed (const ROUTE_TABLE_T * table, const char * input_uri, ROUTE_MATCH_T * match)
+    @brief	등록한 URI 패턴 전체에 대해 한 번에 매칭하고 {} 변수를 타입별로 변환해서 match 에 저장. 메모리 할당하지 않음
+    @param	table		route table
+    @param	input_uri	입력한 URI. 일반적으로 r->uri 전달하면 됨. match 사용하는 동안 유지되어야 함
+    @param	match		매칭 결과 저장할 구조체. 문자열 변수는 input_uri 안의 위치를 가리킴
+    @return	매칭한 패턴의 route id. 매칭 실패시 FAIL
+*/
+int	tb_route_match_typed (const ROUTE_TABLE_T * table, const char * input_uri, ROUTE_MATCH_T * match)
+{
+	match->captures_n = 0 ;
+	match->id = FAIL ;
+
+	if (!table || !input_uri)
+		return	FAIL ;
+
+	match->id = route_match_node(table->root, input_uri, input_uri + strlen(input_uri), match->captures, &match->captures_n) ;
+	if (match->id == FAIL)
+		match->captures_n = 0 ;
+
+	return	match->id ;
+}
+
+static	const ROUTE_CAPTURE_T *	route_capture (const ROUTE_MATCH_T * match, const char * name)
+{
+	int	i ;
+	for (i = 0; match && i < match->captures_n; i++)
+	{
+		if (! strcmp(match->captures[i].name, name))
+			return	&match->captures[i] ;
+	}
+
+	return	NULL ;
+}
+
+/** @fn long	tb_route_integer (const ROUTE_MATCH_T * match, const char * name, long def)
+    @brief	tb_route_match_typed 결과에서 {name:int} 변수 읽기
+    @param	match	tb_route_match_typed 결과
+    @param	name	변수 이름
+    @param	def	기본값
+    @return	변수 값. 없거나 int 타입이 아닌 경우 def
+*/
+long	tb_route_integer (const ROUTE_MATCH_T * match, const char * name, long def)
+{
+	const ROUTE_CAPTURE_T *	capture = route_capture(match, name) ;
+	if (!capture || capture->type != ROUTE_TYPE_INTEGER)
+		return	def ;
+
+	return	capture->integer ;
+}
+
+/** @fn const char *	tb_route_string (apr_pool_t * pool, const ROUTE_MATCH_T * match, const char * name, const char * def)
+    @brief	tb_route_match_typed 결과에서 변수를 문자열로 읽기
+    @param	pool	메모리 할당 풀
+    @param	match	tb_route_match_typed 결과
+    @param	name	변수 이름
+    @param	def	기본값
+    @return	변수 값. 없는 경우 def
+*/
+const char *	tb_route_string (apr_pool_t * pool, const ROUTE_MATCH_T * match, const char * name, const char * def)
+{
+	const ROUTE_CAPTURE_T *	capture = route_capture(match, name) ;
+	if (! capture)
+		return	def ;
+
+	return	apr_pstrmemdup(pool, capture->value, capture->value_n) ;
+}
+
+/** @fn int	tb_route_match (request_rec * r, const ROUTE_TABLE_T * table, const char * input_uri, apr_table_t * params)
+    @brief	등록한 URI 패턴 전체에 대해 한 번에 매칭하고 매칭시 {} 변수를 파라미터로 추가. tb_match_uri 와 같이 .json 도 허용함
+    @param	r		request_rec. 메모리 할당
+    @param	table		route table
+    @param	input_uri	입력한 URI. 일반적으로 r->uri 전달하면 됨
+    @param	params		{} 매칭시 파라미터 추가할 table. NULL 이면 추가하지 않음
+    @return	매칭한 패턴의 route id. 매칭 실패시 FAIL
+*/
+int	tb_route_match (request_rec * r, const ROUTE_TABLE_T * table, const char * input_uri, apr_table_t * params)
+{
+	ROUTE_MATCH_T	match ;
+	int		id = tb_route_match_typed(table, input_uri, &match) ;
+
+	if (id != FAIL && params)
+	{
+		int	i ;
+		for (i = 0; i < match.captures_n; i++)
+			apr_table_setn(params, match.captures[i].name, apr_pstrmemdup(r->pool, match.captures[i].value, match.captures[i].value_n)) ;
+	}
+
+	return	id ;
+}
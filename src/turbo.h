@@ -34,6 +34,127 @@
 #define FAIL			-1
 #define SUCCESS			0
 
+/** multipart part 정보. header 는 part 시작 전에 모두 채워지고 data_n 은 part 끝날 때 확정됨 */
+typedef struct
+{
+	const char *	key ;
+	const char *	filename ;
+	const char *	content_type ;
+	apr_table_t *	headers ;
+	apr_off_t	offset ;	/* body 안에서 part data 시작 위치 */
+	const char *	data ;		/* body 를 버퍼링한 경우 body 안의 part data 위치. streaming 파싱시 NULL */
+	size_t		data_n ;
+	int		digests ;	/* 받으면서 계산한 digest. MULTIPART_DIGEST_* */
+	unsigned char	md5 [16] ;
+	unsigned char	sha256 [32] ;
+} MULTIPART_PART_T ;
+
+/* file part 를 받으면서 계산할 digest */
+#define	MULTIPART_DIGEST_MD5		0x01
+#define	MULTIPART_DIGEST_SHA256		0x02
+
+/** multipart streaming parser callback. SUCCESS 반환하면 계속 진행, FAIL 반환하면 파싱 중단 */
+typedef struct
+{
+	int	(* part_begin) (void * data, MULTIPART_PART_T * part) ;
+	int	(* part_data) (void * data, MULTIPART_PART_T * part, const char * buf, size_t len) ;
+	int	(* part_end) (void * data, MULTIPART_PART_T * part) ;
+	int	digests ;	/* file part 에 대해 계산할 digest. MULTIPART_DIGEST_*. part_end 호출 전에 part 에 저장됨 */
+} MULTIPART_CALLBACK_T ;
+
+typedef struct MULTIPART_PARSER_T	MULTIPART_PARSER_T ;
+typedef struct ROUTE_TABLE_T		ROUTE_TABLE_T ;
+typedef struct QUERY_T			QUERY_T ;
+typedef struct S3_STREAM_T		S3_STREAM_T ;
+typedef struct JSON_WRITER_T		JSON_WRITER_T ;
+typedef struct DIGEST_T			DIGEST_T ;
+typedef struct AWS_ASYNC_T		AWS_ASYNC_T ;
+typedef struct SQS_BATCH_T		SQS_BATCH_T ;
+
+/* tb_digest_make 알고리즘 */
+enum
+{
+	DIGEST_MD5 = 0,
+	DIGEST_SHA1,
+	DIGEST_SHA256,
+} ;
+
+/* digest 결과 최대 크기(EVP_MAX_MD_SIZE) */
+#define	DIGEST_SIZE_MAX		64
+
+/* len byte 를 base64 로 인코딩한 길이. NULL 문자 제외 */
+#define	TB_BASE64_ENCODED_LEN(len)	(((len) + 2) / 3 * 4)
+
+enum
+{
+	JSON_NULL = 0,
+	JSON_FALSE,
+	JSON_TRUE,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+} ;
+
+/** JSON 값. 파싱한 순서대로 한 배열에 저장되고 array, object 의 자식은 바로 뒤에 이어짐.
+    key, value 는 파싱한 버퍼 안의 위치를 가리키며 NULL 종료됨 */
+typedef struct
+{
+	int		type ;
+	const char *	key ;		/* object 멤버인 경우 key. 아니면 NULL */
+	size_t		key_n ;
+	const char *	value ;		/* 문자열, 숫자, true, false, null */
+	size_t		value_n ;
+	int		children_n ;	/* array, object 자식 개수 */
+	int		next ;		/* 다음 형제 node 위치. 없으면 0 */
+} JSON_NODE_T ;
+
+typedef struct
+{
+	JSON_NODE_T *	nodes ;
+	int		nodes_n ;
+} JSON_T ;
+
+/* request_params_parse_ex flags */
+#define	REQUEST_PARSE_LAZY_QUERY	0x01
+#define	REQUEST_PARSE_DIGEST_MD5	0x02
+#define	REQUEST_PARSE_DIGEST_SHA256	0x04
+#define	REQUEST_PARSE_MULTI_VALUE	0x08
+
+/* 한 URI 에서 뽑을 수 있는 {} 변수 최대 개수 */
+#define	ROUTE_CAPTURE_MAX	16
+
+enum
+{
+	ROUTE_TYPE_STRING = 0,
+	ROUTE_TYPE_INTEGER,
+} ;
+
+/** route {} 변수 매칭 결과. value 는 입력 URI 안의 위치를 가리키며 NULL 종료되지 않음 */
+typedef struct
+{
+	const char *	name ;
+	int		type ;
+	const char *	value ;
+	size_t		value_n ;
+	long		integer ;	/* ROUTE_TYPE_INTEGER 인 경우 변환한 값 */
+} ROUTE_CAPTURE_T ;
+
+typedef struct
+{
+	int		id ;
+	int		captures_n ;
+	ROUTE_CAPTURE_T	captures [ROUTE_CAPTURE_MAX] ;
+} ROUTE_MATCH_T ;
+
+#define	MULTIPART_HEADER_MAX	4096
+
+/* tb_ltoa, tb_dtoa 등 숫자 변환 출력 버퍼 크기 */
+#define	TB_NUMBER_BUF_SIZE	32
+
+/* tb_parse_* 에서 숫자 형식은 맞지만 범위를 넘은 경우 */
+#define	TB_PARSE_OVERFLOW	-2
+
 typedef struct
 {
 	struct
@@ -44,12 +165,23 @@ typedef struct
 		const char *	data ;
 		size_t		data_n ;
 	}	multipart ;
+	apr_array_header_t *	parts ;		/* multipart file 목록. MULTIPART_PART_T * array */
 	size_t	multipart_size ;
 	size_t	multipart_read_n ;
 
 	apr_table_t *	params ;
+	QUERY_T *	query ;		/* REQUEST_PARSE_LAZY_QUERY 인 경우 GET 파라미터 */
+	JSON_T *	json ;		/* application/json POST body */
 } REQUEST_PARSE_T ;
 
+/** tb_memsearch 용 탐색기. tb_memsearch_init 으로 초기화 */
+typedef struct
+{
+	const char *	str ;
+	size_t		str_n ;
+	unsigned int	skip [256] ;
+} MEMSEARCH_T ;
+
 typedef	struct
 {
 	long		status ;
@@ -57,17 +189,101 @@ typedef	struct
 	const char *	data ;
 } AWS_RESPONSE_T ;
 
+/* tb_aws_async_* 요청 완료 callback. 전송 실패시 response 는 NULL */
+typedef void	(* AWS_ASYNC_CALLBACK_T) (void * data, int id, AWS_RESPONSE_T * response) ;
+
+/* tb_sqs_batch_* 메세지 별 결과 callback. result 는 SUCCESS, FAIL 이고 실패시 error 는 SQS error code */
+typedef void	(* SQS_BATCH_CALLBACK_T) (void * data, int id, int result, const char * error) ;
+
 /* request.c */
 REQUEST_PARSE_T		request_params_parse (request_rec * r) ;
+REQUEST_PARSE_T		request_params_parse_ex (request_rec * r, int flags) ;
+const char *	tb_query_string (QUERY_T * query, const char * name, const char * def) ;
+int	tb_query_integer (QUERY_T * query, const char * name, int def) ;
+apr_array_header_t *	tb_query_values (apr_pool_t * pool, QUERY_T * query, const char * name) ;
+const char *	tb_param_string (REQUEST_PARSE_T * rp, const char * name, const char * def) ;
+int	tb_param_integer (REQUEST_PARSE_T * rp, const char * name, int def) ;
+apr_array_header_t *	tb_param_values (apr_pool_t * pool, REQUEST_PARSE_T * rp, const char * name) ;
+void	tb_set_multipart_spill_size (apr_off_t size) ;
+void	tb_set_multipart_body_limit (apr_off_t limit) ;
+void	tb_set_form_body_limit (apr_off_t limit) ;
+void	tb_set_inflate_body_limit (apr_off_t limit) ;
+const MULTIPART_PART_T *	tb_request_part (const REQUEST_PARSE_T * rp, const char * key) ;
+int	tb_request_multipart_parse (request_rec * r, const MULTIPART_CALLBACK_T * callback, void * data) ;
 int	tb_match_uri (request_rec * r, const char * input_uri, const char * uri, apr_table_t * params) ;
 
+/* multipart.c */
+const char *	tb_multipart_boundary (apr_pool_t * pool, const char * content_type) ;
+MULTIPART_PARSER_T *	tb_multipart_parser_create (apr_pool_t * pool, const char * boundary, const MULTIPART_CALLBACK_T * callback, void * data) ;
+int	tb_multipart_parser_execute (MULTIPART_PARSER_T * parser, const char * buf, size_t len) ;
+int	tb_multipart_parser_finish (MULTIPART_PARSER_T * parser) ;
+const char *	tb_multipart_digest_hex (apr_pool_t * pool, const MULTIPART_PART_T * part, int digest) ;
+
+/* route.c */
+ROUTE_TABLE_T *	tb_route_table_make (apr_pool_t * pool) ;
+int	tb_route_add (ROUTE_TABLE_T * table, const char * uri, int id) ;
+int	tb_route_match (request_rec * r, const ROUTE_TABLE_T * table, const char * input_uri, apr_table_t * params) ;
+int	tb_route_match_typed (const ROUTE_TABLE_T * table, const char * input_uri, ROUTE_MATCH_T * match) ;
+long	tb_route_integer (const ROUTE_MATCH_T * match, const char * name, long def) ;
+const char *	tb_route_string (apr_pool_t * pool, const ROUTE_MATCH_T * match, const char * name, const char * def) ;
+
+/* json.c */
+JSON_T *	tb_json_parse (apr_pool_t * pool, char * buf, size_t len) ;
+const JSON_NODE_T *	tb_json_root (const JSON_T * json) ;
+const JSON_NODE_T *	tb_json_child (const JSON_T * json, const JSON_NODE_T * node) ;
+const JSON_NODE_T *	tb_json_next (const JSON_T * json, const JSON_NODE_T * node) ;
+const JSON_NODE_T *	tb_json_get (const JSON_T * json, const JSON_NODE_T * node, const char * key) ;
+const JSON_NODE_T *	tb_json_at (const JSON_T * json, const JSON_NODE_T * node, int index) ;
+const char *	tb_json_string (const JSON_NODE_T * node, const char * def) ;
+long	tb_json_integer (const JSON_NODE_T * node, long def) ;
+double	tb_json_double (const JSON_NODE_T * node, double def) ;
+int	tb_json_boolean (const JSON_NODE_T * node, int def) ;
+JSON_WRITER_T *	tb_json_writer_make (apr_pool_t * pool, size_t size) ;
+JSON_WRITER_T *	tb_json_writer_make_output (request_rec * r, size_t chunk_size) ;
+int	tb_json_writer_flush (JSON_WRITER_T * writer) ;
+void	tb_json_writer_text (JSON_WRITER_T * writer, const char * text, size_t len) ;
+void	tb_json_writer_begin_object (JSON_WRITER_T * writer) ;
+void	tb_json_writer_end_object (JSON_WRITER_T * writer) ;
+void	tb_json_writer_begin_array (JSON_WRITER_T * writer) ;
+void	tb_json_writer_end_array (JSON_WRITER_T * writer) ;
+void	tb_json_writer_key (JSON_WRITER_T * writer, const char * key) ;
+void	tb_json_writer_string (JSON_WRITER_T * writer, const char * str) ;
+void	tb_json_writer_string_n (JSON_WRITER_T * writer, const char * str, size_t len) ;
+void	tb_json_writer_integer (JSON_WRITER_T * writer, long value) ;
+void	tb_json_writer_double (JSON_WRITER_T * writer, double value) ;
+void	tb_json_writer_double_fixed (JSON_WRITER_T * writer, double value, int precision) ;
+void	tb_json_writer_boolean (JSON_WRITER_T * writer, int value) ;
+void	tb_json_writer_null (JSON_WRITER_T * writer) ;
+void	tb_json_writer_raw (JSON_WRITER_T * writer, const char * json) ;
+const char *	tb_json_writer_result (JSON_WRITER_T * writer, size_t * len) ;
+
+/* number.c */
+char *	tb_utoa (char * buf, unsigned long value) ;
+char *	tb_ltoa (char * buf, long value) ;
+char *	tb_dtoa (char * buf, double value) ;
+char *	tb_ftoa (char * buf, float value) ;
+char *	tb_dtoa_fixed (char * buf, double value, int precision) ;
+int	tb_parse_long (const char * src, size_t len, long * value) ;
+int	tb_parse_int (const char * src, size_t len, int * value) ;
+int	tb_parse_long_prefix (const char * src, size_t len, long * value, const char ** end) ;
+int	tb_parse_double (const char * src, size_t len, double * value) ;
+int	tb_parse_double_prefix (const char * src, size_t len, double * value, const char ** end) ;
+
 /* util.c */
 char *	tb_escape_url (apr_pool_t * pool, const char * string) ;
+char *	tb_escape_url_buffer (char * dst, const char * src, size_t len) ;
 char *	tb_escape_chars (apr_pool_t * pool, const char * src, const char * chars) ;
+char *	tb_escape_chars_buffer (char * dst, const char * src, size_t len, const char * chars) ;
 char *	tb_escape_json (apr_pool_t * pool, const char * src) ;
+const char *	tb_escape_json_find (const char * p, const char * e) ;
+size_t	tb_escape_json_length (const char * src, size_t len) ;
+char *	tb_escape_json_buffer (char * dst, const char * src, size_t len) ;
 char *	tb_json_escaped_string (apr_pool_t * pool, const char * str) ;
 char *	tb_quoted_string (apr_pool_t * pool, const char * str, int null) ;
 char *	tb_memstr (const char * mem, size_t mem_len, const char * str) ;
+void	tb_memsearch_init (MEMSEARCH_T * search, const char * str, size_t str_n) ;
+MEMSEARCH_T *	tb_memsearch_compile (apr_pool_t * pool, const char * str, size_t str_n) ;
+char *	tb_memsearch (const MEMSEARCH_T * search, const char * mem, size_t mem_len) ;
 const char *	tb_replace_string (apr_pool_t * pool, const char * src, const char * pattern, const char * replace) ;
 char *	tb_strncopy (char * dest, const char * src, size_t n) ;
 char *	tb_key_value_json_string (apr_pool_t * pool, const char * key, const char * value) ;
@@ -78,6 +294,7 @@ char *	tb_key_value_json_long (apr_pool_t * pool, const char * key, long value)
 char *	tb_key_value_json_float (apr_pool_t * pool, const char * key, float value) ;
 char *	tb_key_value_json_double (apr_pool_t * pool, const char * key, double value) ;
 char *	tb_key_value_json_boolean (apr_pool_t * pool, const char * key, int value) ;
+void	tb_set_json_double_precision (int precision) ;
 char *	tb_key_map_json_string (apr_pool_t * pool, const char * key, apr_array_header_t * a) ;
 char *	tb_map_json_string (apr_pool_t * pool, apr_array_header_t * a) ;
 char *	tb_key_list_json_string (apr_pool_t * pool, const char * key, apr_array_header_t * a) ;
@@ -89,6 +306,7 @@ char *	tb_boolean_string (const char * str) ;
 char 	tb_boolean (const char * str) ;
 int	tb_table_integer (apr_table_t * t, const char * name, int def) ;
 const char *	tb_table_string (apr_table_t * t, const char * name, const char * def) ;
+apr_array_header_t *	tb_table_values (apr_pool_t * pool, apr_table_t * t, const char * name) ;
 int	tb_atoi (const char * src, int def) ;
 long	tb_atol (const char * src, long def) ;
 double	tb_atof (const char * src, double def) ;
@@ -96,6 +314,16 @@ time_t	tb_atot (const char * src, time_t def) ;
 char	tb_atob (const char * src, char def) ;
 const char *	tb_random_string (apr_pool_t * pool, int n) ;
 const char *	tb_table_to_url (apr_pool_t * pool, apr_table_t * t) ;
+char *	tb_hex_encode (char * dst, const void * src, size_t len) ;
+char *	tb_base64_encode (char * dst, const void * src, size_t len) ;
+DIGEST_T *	tb_digest_make (apr_pool_t * pool, int type) ;
+int	tb_digest_reset (DIGEST_T * digest) ;
+int	tb_digest_update (DIGEST_T * digest, const void * data, size_t len) ;
+int	tb_digest_update_file (DIGEST_T * digest, apr_file_t * file) ;
+int	tb_digest_update_brigade (DIGEST_T * digest, apr_bucket_brigade * bb) ;
+unsigned int	tb_digest_final (DIGEST_T * digest, unsigned char * md) ;
+const char *	tb_digest_final_hex (apr_pool_t * pool, DIGEST_T * digest) ;
+const char *	tb_digest_final_base64 (apr_pool_t * pool, DIGEST_T * digest) ;
 const char *	tb_sha256_hash (apr_pool_t * pool, const char * str) ;
 const char *	tb_sha1_hash_raw (apr_pool_t * pool, const char * str, size_t str_len) ;
 const char *	tb_sha1_hash (apr_pool_t * pool, const char * str) ;
@@ -114,19 +342,37 @@ const char *	tb_date_basic (apr_pool_t * pool, time_t time, int gmt) ;
 /* aws.c */
 const char *	tb_aws_signature (apr_pool_t * pool, const char * key, const char * str, int sha1) ;
 void	tb_aws_init (const char * access_key, const char * secret_key) ;
+void	tb_aws_final (void) ;
 void	tb_ses_init (const char * email_sender) ;
 int	tb_ses_send (request_rec * r, const char * email, const char * subject, const char * content, int html, int real) ;
 void	tb_s3_init (const char * bucket) ;
 int	tb_s3_upload (request_rec * r, const char * path, const char * data, size_t data_n, const char * content_type, int public_read) ;
+int	tb_s3_upload_part (request_rec * r, const char * path, const MULTIPART_PART_T * part, int public_read) ;
+void	tb_set_s3_part_size (size_t size) ;
+S3_STREAM_T *	tb_s3_stream_open (request_rec * r, const char * path, const char * content_type, int public_read) ;
+int	tb_s3_stream_write (S3_STREAM_T * stream, const char * data, size_t data_n) ;
+int	tb_s3_stream_close (S3_STREAM_T * stream) ;
+void	tb_s3_stream_abort (S3_STREAM_T * stream) ;
+int	tb_s3_upload_request (request_rec * r, const char * key, const char * path, int public_read, apr_table_t * params) ;
 int	tb_s3_delete (request_rec * r, const char * path) ;
 int	tb_s3_move (request_rec * r, const char * src_path, const char * dest_path, int public_read) ;
+AWS_ASYNC_T *	tb_aws_async_make (request_rec * r) ;
+int	tb_aws_async_wait_any (AWS_ASYNC_T * async) ;
+int	tb_aws_async_wait_all (AWS_ASYNC_T * async) ;
+AWS_RESPONSE_T *	tb_aws_async_response (AWS_ASYNC_T * async, int id) ;
 int	tb_sqs_send (request_rec * r, const char * endpoint, const char * body) ;
+int	tb_sqs_send_async (AWS_ASYNC_T * async, const char * endpoint, const char * body, AWS_ASYNC_CALLBACK_T callback, void * data) ;
+SQS_BATCH_T *	tb_sqs_batch_make (request_rec * r, const char * endpoint, int linger_ms, SQS_BATCH_CALLBACK_T callback, void * data) ;
+int	tb_sqs_batch_send (SQS_BATCH_T * batch, const char * body) ;
+int	tb_sqs_batch_flush (SQS_BATCH_T * batch) ;
+int	tb_sqs_batch_close (SQS_BATCH_T * batch) ;
 void	tb_sns_push_init (const char * ios_arn, const char * android_arn) ;
 AWS_RESPONSE_T *	tb_sns_add_push_key_raw (request_rec * r, const char * user_data, const char * mobile_type, const char * device_key) ;
 const char *	tb_sns_parse_arn (apr_pool_t * pool, const char * body) ;
 const char *	tb_sns_add_push_key (request_rec * r, const char * user_data, const char * mobile_type, const char * device_key) ;
 int	tb_sns_arn_delete (request_rec * r, const char * sns_arn) ;
 AWS_RESPONSE_T *	tb_sns_push_send (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real) ;
+int	tb_sns_push_send_async (AWS_ASYNC_T * async, const char * mobile_type, const char * sns_arn, const char * message, int badge, apr_table_t * custom, int real, AWS_ASYNC_CALLBACK_T callback, void * data) ;
 AWS_RESPONSE_T *	tb_sns_push_publish (request_rec * r, const char * mobile_type, const char * sns_arn, const char * message, apr_table_t * custom, int real) ;
 int	tb_sns_set_endpoint_attributes (request_rec * r, const char * sns_arn, const char * key, const char * value) ;
 void	tb_cf_signer_init (const char * key_pair_id, char * private_key) ;
@@ -137,6 +383,7 @@ const char *	tb_cf_signer_get_url (apr_pool_t * pool, const char * base_url, tim
 void		tb_image_init () ;
 void		tb_image_final () ;
 const char *	tb_image_resize_crop (apr_pool_t * pool, const char * data, size_t data_n, size_t * result_len, int width, int height) ;
+const char *	tb_image_resize_crop_part (apr_pool_t * pool, const MULTIPART_PART_T * part, size_t * result_len, int width, int height) ;
 
 
 #endif
@@ -8,60 +8,124 @@
 #include <openssl/hmac.h>
 #include <openssl/evp.h>
 #include <openssl/pem.h>
-#include <openssl/md5.h>
+#include <apr_file_io.h>
+#include <limits.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #include "turbo.h"
 
-static int	is_http_reserved (int c)
+/* RFC 3986 unreserved 문자 표. 1 이면 escape 하지 않음 */
+static	const char	url_unreserved_table [256] =
 {
+	['0' ... '9'] = 1,
+	['A' ... 'Z'] = 1,
+	['a' ... 'z'] = 1,
+	['-'] = 1, ['.'] = 1, ['_'] = 1, ['~'] = 1,
+} ;
+
+static	const char	url_hex [] = "0123456789ABCDEF" ;
+
+/* json \u00XX escape, tb_hex_encode 에서 사용 */
+static	const char	hex_digits [] = "0123456789abcdef" ;
+
+/** @fn char *	tb_escape_url_buffer (char * dst, const char * src, size_t len)
+    @brief	문자열 URL escape 해서 dst 에 쓰기. RFC 3986 unreserved 문자(영문, 숫자, - . _ ~) 외에는 %XX 로 변환. NULL 문자는 붙이지 않음
+    @param	dst	출력 버퍼. len * 3 이상이어야 함
+    @param	src	문자열
+    @param	len	문자열 길이
+    @return	dst 에 쓴 마지막 문자 다음 위치
+*/
+char *	tb_escape_url_buffer (char * dst, const char * src, size_t len)
+{
+	const unsigned char *	p = (const unsigned char *)src ;
+	const unsigned char *	e = p + len ;
+
+	for (; p < e; p++)
+	{
+		if (url_unreserved_table[*p])
+		{
+			*dst++ = *p ;
+			continue ;
+		}
 
-	if(isalnum(c) || c == '.' || c == '_')
-		return 0;
+		*dst++ = '%' ;
+		*dst++ = url_hex[*p >> 4] ;
+		*dst++ = url_hex[*p & 0x0f] ;
+	}
 
-	return 1;
+	return	dst ;
 }
 
 /** @fn char *	tb_escape_url (apr_pool_t * pool, const char * string)
-    @brief	문자열 URL escape
+    @brief	문자열 URL escape. RFC 3986 unreserved 문자(영문, 숫자, - . _ ~) 외에는 %XX 로 변환
     @param	pool	메모리 할당 풀
     @param	string	문자열
     @return	URL escape 한 문자열
 */
 char *	tb_escape_url (apr_pool_t * pool, const char * string)
 {
-	int	size = 1;
-	char	* p;
-	char    *cp;
-	char    *out;
+	const char *	p = string ;
 
-	for(p = (char *)string ; p[0] ; p++){
+	/* escape 할 필요 없는 앞부분은 그대로 복사하고 나머지만 최대 크기로 할당 */
+	while (url_unreserved_table[(unsigned char)*p])
+		p++ ;
 
-		if(is_http_reserved(p[0]))
-			size += 3;
-		else
-			size++;
-	}
+	size_t	prefix_n = p - string ;
+	size_t	len = prefix_n + strlen(p) ;
+	char *	out = apr_palloc(pool, prefix_n + (len - prefix_n) * 3 + 1) ;
 
-	out = apr_palloc(pool, size);
-	cp = out;
-	for(; string[0]; string++){
+	memcpy(out, string, prefix_n) ;
+	*tb_escape_url_buffer(out + prefix_n, p, len - prefix_n) = '\0' ;
 
-		if(is_http_reserved(string[0])){
+	return	out ;
+}
 
-			snprintf(cp, sizeof(char) * 4, "%%%02X", (unsigned char)string[0]);
-			cp += 3;
-		}
-		else{
+/* escape 할 문자 목록을 256 bit bitmap 으로 변환 */
+static	void	escape_chars_bitmap (const char * chars, unsigned int bitmap[8])
+{
+	memset(bitmap, 0, sizeof(unsigned int) * 8) ;
 
-			cp[0] = string[0];
-			cp++;
+	for (; *chars; chars++)
+	{
+		unsigned char	c = *chars ;
+		bitmap[c >> 5] |= 1u << (c & 31) ;
+	}
+}
 
-		}
+#define	ESCAPE_CHARS_TEST(bitmap, c)	((bitmap)[(unsigned char)(c) >> 5] & (1u << ((unsigned char)(c) & 31)))
 
+static	char *	escape_chars_write (char * dst, const char * p, const char * e, const unsigned int bitmap[8])
+{
+	for (; p < e; p++)
+	{
+		if (ESCAPE_CHARS_TEST(bitmap, *p))
+			*dst++ = '\\' ;
+		*dst++ = *p ;
 	}
-	cp[0] = '\0';
 
-	return out;
+	return	dst ;
+}
+
+/** @fn char *	tb_escape_chars_buffer (char * dst, const char * src, size_t len, const char * chars)
+    @brief	지정한 문자를 backslash(\) escape 처리해서 dst 에 쓰기. NULL 문자는 붙이지 않음
+    @param	dst	출력 버퍼. len * 2 이상이어야 함
+    @param	src	escape 처리할 source 문자열
+    @param	len	문자열 길이
+    @param	chars	escape 처리할 문자 목록
+    @return	dst 에 쓴 마지막 문자 다음 위치
+*/
+char *	tb_escape_chars_buffer (char * dst, const char * src, size_t len, const char * chars)
+{
+	unsigned int	bitmap [8] ;
+	escape_chars_bitmap(chars, bitmap) ;
+
+	return	escape_chars_write(dst, src, src + len, bitmap) ;
 }
 
 /** @fn char *	tb_escape_chars (apr_pool_t * pool, const char * src, const char * chars)
@@ -73,135 +137,163 @@ char *	tb_escape_url (apr_pool_t * pool, const char * string)
 */
 char *	tb_escape_chars (apr_pool_t * pool, const char * src, const char * chars)
 {
-	char *	escaped ;
-	char *	p ;
-	char *	d ;
-	int	len ;
-	int	replace = 0 ;
-	int	i ;
-	int	chars_n = strlen(chars) ;
+	unsigned int	bitmap [8] ;
+	const char *	p = src ;
 
-	p = (char *)src ;
-	while (*p)
-	{
-		for (i = 0; i < chars_n; i++)
-		{
-			if (*p == chars[i])
-			{
-				replace++ ;
-				break ;
-			}
-		}
+	escape_chars_bitmap(chars, bitmap) ;
 
+	/* NULL 문자는 bitmap 에 없으므로 문자열 끝에서 멈춤 */
+	bitmap[0] |= 1 ;
+	while (! ESCAPE_CHARS_TEST(bitmap, *p))
 		p++ ;
-	}
+	bitmap[0] &= ~1u ;
+
+	if (! *p) return NULL ;
+
+	size_t	prefix_n = p - src ;
+	size_t	len = prefix_n + strlen(p) ;
+	char *	escaped = apr_palloc(pool, prefix_n + (len - prefix_n) * 2 + 1) ;
 
-	if (! replace) return NULL ;
+	memcpy(escaped, src, prefix_n) ;
+	*escape_chars_write(escaped + prefix_n, p, src + len, bitmap) = '\0' ;
 
-	len = p - src ;
-	escaped = apr_palloc(pool, len + replace * 2 + 1) ;
+	return	escaped ;
+}
 
-	p = (char *)src ;
-	d = escaped ;
+/* JSON escape 표. 0 이면 그대로, 'u' 면 \u00XX, 그 외는 backslash 뒤에 붙일 문자 */
+static	const char	json_escape_table [256] =
+{
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+	['"'] = '"',
+	['\\'] = '\\',
+} ;
+
+/** @fn const char *	tb_escape_json_find (const char * p, const char * e)
+    @brief	json escape 필요한 첫 문자 찾기. SSE2/AVX2 로 16/32 byte 씩 검사해서 건너뜀
+    @param	p	검사할 문자열 시작
+    @param	e	검사할 문자열 끝
+    @return	escape 필요한 첫 문자 위치. 없으면 e
+*/
+const char *	tb_escape_json_find (const char * p, const char * e)
+{
+#if defined(__AVX2__)
+	const __m256i	quote32 = _mm256_set1_epi8('"') ;
+	const __m256i	backslash32 = _mm256_set1_epi8('\\') ;
+	const __m256i	control32 = _mm256_set1_epi8(0x1f) ;
 
-	while (*p)
+	while (e - p >= 32)
 	{
-		for (i = 0; i < chars_n; i++)
-		{
-			if (*p == chars[i])
-			{
-				*d++ = '\\' ;
-				break ;
-			}
-		}
+		__m256i		v = _mm256_loadu_si256((const __m256i *)p) ;
+		__m256i		m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32)), _mm256_cmpeq_epi8(_mm256_min_epu8(v, control32), v)) ;
+		unsigned int	mask = _mm256_movemask_epi8(m) ;
 
-		*d++ = *p++ ;
+		if (mask)
+			return	p + __builtin_ctz(mask) ;
+		p += 32 ;
 	}
+#endif
+#if defined(__SSE2__)
+	const __m128i	quote = _mm_set1_epi8('"') ;
+	const __m128i	backslash = _mm_set1_epi8('\\') ;
+	const __m128i	control = _mm_set1_epi8(0x1f) ;
+
+	/* control 문자는 unsigned 비교해야 하므로 min(v, 0x1f) == v 로 검사 */
+	while (e - p >= 16)
+	{
+		__m128i		v = _mm_loadu_si128((const __m128i *)p) ;
+		__m128i		m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmpeq_epi8(_mm_min_epu8(v, control), v)) ;
+		unsigned int	mask = _mm_movemask_epi8(m) ;
 
-	*d = '\0' ;
+		if (mask)
+			return	p + __builtin_ctz(mask) ;
+		p += 16 ;
+	}
+#endif
 
-	return	escaped ;
+	while (p < e && !json_escape_table[(unsigned char)*p])
+		p++ ;
+
+	return	p ;
 }
 
-/** @fn char *	tb_escape_json (apr_pool_t * pool, const char * src)
-    @brief	json escape 처리(\\b \\f \\n \\r \\t \\v ")
-    @param	pool	메모리 할당 풀
+/** @fn size_t	tb_escape_json_length (const char * src, size_t len)
+    @brief	json escape 처리한 결과 길이. tb_escape_json_buffer 에 넘길 버퍼를 정확한 크기로 잡을 때 사용. 입력을 한 번 더 읽으므로 최대 크기(len * 6)로 잡아도 되면 사용하지 않음
     @param	src	json escape 처리할 문자열
-    @return	escape 처리한 문자열. escape 처리할 문자가 하나도 없는 경우 NULL 반환
+    @param	len	문자열 길이
+    @return	escape 처리한 문자열 길이. NULL 문자 제외
 */
-char *	tb_escape_json (apr_pool_t * pool, const char * src)
+size_t	tb_escape_json_length (const char * src, size_t len)
 {
-	char *	escaped ;
-	char *	p ;
-	char *	d ;
-	int	len ;
-	int	replace = 0 ;
-	int	i ;
+	const char *	p = src ;
+	const char *	e = src + len ;
+	size_t		size = len ;
 
-	static	struct
-	{
-		char	special ;
-		char	convert ;
-	}	map[] =
-	{
-		{	'\b',	'b'	},
-		{	'\f',	'f'	},
-		{	'\n',	'n'	},
-		{	'\r',	'r'	},
-		{	'\t',	't'	},
-		{	'\v',	'v'	},
-		{	'\"',	'\"'	},
-		{	'\\',	'\\'	},
-	} ;
-	static	size_t	map_n = _N(map) ;
-
-	p = (char *)src ;
-	while (*p)
-	{
-		for (i = 0; i < map_n; i++)
-		{
-			if (*p == map[i].special)
-			{
-				replace++ ;
-				break ;
-			}
-		}
+	while ((p = tb_escape_json_find(p, e)) < e)
+		size += json_escape_table[(unsigned char)*p++] == 'u' ? 5 : 1 ;
 
-		p++ ;
-	}
+	return	size ;
+}
 
-	if (! replace) return NULL ;
+/** @fn char *	tb_escape_json_buffer (char * dst, const char * src, size_t len)
+    @brief	json escape 처리해서 dst 에 쓰기. escape 할 필요 없는 구간은 한 번에 복사함. NULL 문자는 붙이지 않음
+    @param	dst	출력 버퍼. tb_escape_json_length 크기 이상이어야 함. len * 6 이면 항상 충분함
+    @param	src	json escape 처리할 문자열
+    @param	len	문자열 길이
+    @return	dst 에 쓴 마지막 문자 다음 위치
+*/
+char *	tb_escape_json_buffer (char * dst, const char * src, size_t len)
+{
+	const char *	e = src + len ;
 
-	len = p - src ;
-	escaped = apr_palloc(pool, len + replace * 2 + 1) ;
+	for (;;)
+	{
+		const char *	p = tb_escape_json_find(src, e) ;
 
-	p = (char *)src ;
-	d = escaped ;
+		memcpy(dst, src, p - src) ;
+		dst += p - src ;
+		if (p == e)
+			break ;
 
-	int	skip ;
-	while (*p)
-	{
-		skip = 0 ;
-		for (i = 0; i < map_n; i++)
+		unsigned char	c = *p ;
+		char		escape = json_escape_table[c] ;
+
+		*dst++ = '\\' ;
+		if (escape == 'u')
 		{
-			if (*p == map[i].special)
-			{
-				*d++ = '\\' ;
-				if (*p != map[i].convert)
-				{
-					*d++ = map[i].convert ;
-					p++ ;
-					skip = 1 ;
-				}
-				break ;
-			}
+			*dst++ = 'u', *dst++ = '0', *dst++ = '0' ;
+			*dst++ = hex_digits[c >> 4] ;
+			*dst++ = hex_digits[c & 0x0f] ;
 		}
+		else
+			*dst++ = escape ;
 
-		if (! skip)
-			*d++ = *p++ ;
+		src = p + 1 ;
 	}
 
-	*d = '\0' ;
+	return	dst ;
+}
+
+/** @fn char *	tb_escape_json (apr_pool_t * pool, const char * src)
+    @brief	json escape 처리(\\b \\f \\n \\r \\t " \\). 그 외 0x20 미만 control 문자는 \\u00XX 로 변환
+    @param	pool	메모리 할당 풀
+    @param	src	json escape 처리할 문자열
+    @return	escape 처리한 문자열. escape 처리할 문자가 하나도 없는 경우 NULL 반환
+*/
+char *	tb_escape_json (apr_pool_t * pool, const char * src)
+{
+	size_t		len = strlen(src) ;
+	const char *	e = src + len ;
+	const char *	p = tb_escape_json_find(src, e) ;
+
+	if (p == e) return NULL ;
+
+	/* 첫 escape 문자부터는 한 문자가 최대 6자가 되므로 그만큼 확보하고 이어서 한 번에 씀 */
+	size_t	prefix_n = p - src ;
+	char *	escaped = apr_palloc(pool, prefix_n + (e - p) * 6 + 1) ;
+
+	memcpy(escaped, src, prefix_n) ;
+	*tb_escape_json_buffer(escaped + prefix_n, p, e - p) = '\0' ;
 
 	return	escaped ;
 }
@@ -244,31 +336,153 @@ char *	tb_quoted_string (apr_pool_t * pool, const char * str, int null)
 	return	null ? "null" : "\"\"" ;
 }
 
-/** @fn char *	tb_memstr (const char * mem, size_t mem_len, const char * str)
-    @brief	strstr의 메모리 버전. strstr과 달리 중간에 NULL 문자 있어도 끝까지 탐색함
-    @param	mem	문자열 찾을 메모리 주소
-    @param	mem_len	mem의 길이
+/** @fn void	tb_memsearch_init (MEMSEARCH_T * search, const char * str, size_t str_n)
+    @brief	메모리 탐색기 초기화. 찾을 문자열로 Boyer-Moore-Horspool skip table 을 미리 만들어서 같은 문자열을 반복해서 찾을 때 사용
+    @param	search	초기화할 탐색기
+    @param	str	찾을 문자열. 복사하지 않으므로 탐색기 사용하는 동안 유지되어야 함
+    @param	str_n	str 의 길이
+*/
+void	tb_memsearch_init (MEMSEARCH_T * search, const char * str, size_t str_n)
+{
+	size_t	i ;
+
+	search->str = str ;
+	search->str_n = str_n ;
+
+	for (i = 0; i < _N(search->skip); i++)
+		search->skip[i] = str_n ? str_n : 1 ;
+
+	for (i = 0; i + 1 < str_n; i++)
+		search->skip[(unsigned char)str[i]] = str_n - 1 - i ;
+}
+
+/** @fn MEMSEARCH_T *	tb_memsearch_compile (apr_pool_t * pool, const char * str, size_t str_n)
+    @brief	메모리 탐색기 생성. tb_memsearch_init 과 달리 찾을 문자열도 pool 에 복사함
+    @param	pool	메모리 할당 풀
     @param	str	찾을 문자열
-    @return	str이 최초로 나온 위치 반환. 없으면 NULL 반환
+    @param	str_n	str 의 길이
+    @return	생성한 탐색기
 */
-char *	tb_memstr (const char * mem, size_t mem_len, const char * str)
+MEMSEARCH_T *	tb_memsearch_compile (apr_pool_t * pool, const char * str, size_t str_n)
+{
+	MEMSEARCH_T *	search = apr_palloc(pool, sizeof(MEMSEARCH_T)) ;
+	tb_memsearch_init(search, apr_pmemdup(pool, str, str_n), str_n) ;
+
+	return	search ;
+}
+
+/* SIMD 로 첫 byte 와 마지막 byte 가 모두 일치하는 위치만 골라서 비교. 후보가 없는 구간은 한 번에 16/32 byte 씩 건너뜀 */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define	MEMSEARCH_SIMD_N	32
+
+static	const char *	memsearch_simd (const MEMSEARCH_T * search, const char * p, const char * e)
 {
-	char *	p = (char *)mem ;
-	char *	e = p + mem_len ;
-	size_t	str_len = strlen(str) ;
+	const char *	str = search->str ;
+	size_t		n = search->str_n ;
+	__m256i		first = _mm256_set1_epi8(str[0]) ;
+	__m256i		last = _mm256_set1_epi8(str[n - 1]) ;
 
-	int	found = 0 ;
-	while (p < e && e - p >= str_len)
+	for (; p + n - 1 + MEMSEARCH_SIMD_N <= e; p += MEMSEARCH_SIMD_N)
 	{
-		if (! strncmp(p, str, str_len))
+		__m256i		block_first = _mm256_loadu_si256((const __m256i *)p) ;
+		__m256i		block_last = _mm256_loadu_si256((const __m256i *)(p + n - 1)) ;
+		unsigned int	mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))) ;
+
+		while (mask)
 		{
-			found = 1 ;
-			break ;
+			int	bit = __builtin_ctz(mask) ;
+			if (! memcmp(p + bit + 1, str + 1, n - 2))
+				return	p + bit ;
+			mask &= mask - 1 ;
+		}
+	}
+
+	return	p ;
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define	MEMSEARCH_SIMD_N	16
+
+static	const char *	memsearch_simd (const MEMSEARCH_T * search, const char * p, const char * e)
+{
+	const char *	str = search->str ;
+	size_t		n = search->str_n ;
+	__m128i		first = _mm_set1_epi8(str[0]) ;
+	__m128i		last = _mm_set1_epi8(str[n - 1]) ;
+
+	for (; p + n - 1 + MEMSEARCH_SIMD_N <= e; p += MEMSEARCH_SIMD_N)
+	{
+		__m128i		block_first = _mm_loadu_si128((const __m128i *)p) ;
+		__m128i		block_last = _mm_loadu_si128((const __m128i *)(p + n - 1)) ;
+		unsigned int	mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))) ;
+
+		while (mask)
+		{
+			int	bit = __builtin_ctz(mask) ;
+			if (! memcmp(p + bit + 1, str + 1, n - 2))
+				return	p + bit ;
+			mask &= mask - 1 ;
 		}
-		p++ ;
 	}
 
-	return	found ? p : NULL ;
+	return	p ;
+}
+#endif
+
+/** @fn char *	tb_memsearch (const MEMSEARCH_T * search, const char * mem, size_t mem_len)
+    @brief	tb_memsearch_init 으로 초기화한 탐색기로 메모리에서 문자열 찾기. binary 데이터도 끝까지 탐색함
+    @param	search	탐색기
+    @param	mem	문자열 찾을 메모리 주소
+    @param	mem_len	mem의 길이
+    @return	문자열이 최초로 나온 위치 반환. 없으면 NULL 반환
+*/
+char *	tb_memsearch (const MEMSEARCH_T * search, const char * mem, size_t mem_len)
+{
+	const char *	str = search->str ;
+	size_t		n = search->str_n ;
+	const char *	p = mem ;
+	const char *	e = mem + mem_len ;
+
+	if (n == 0)
+		return	(char *)mem ;
+	if (n > mem_len)
+		return	NULL ;
+	if (n == 1)
+		return	memchr(mem, *str, mem_len) ;
+
+#ifdef	MEMSEARCH_SIMD_N
+	p = memsearch_simd(search, p, e) ;
+	if (p + n - 1 + MEMSEARCH_SIMD_N <= e)
+		return	(char *)p ;
+#endif
+
+	/* Boyer-Moore-Horspool. SIMD 로 처리하고 남은 끝부분이나 SIMD 사용할 수 없는 경우 */
+	unsigned char	last = str[n - 1] ;
+	while (p + n <= e)
+	{
+		unsigned char	c = p[n - 1] ;
+		if (c == last && !memcmp(p, str, n - 1))
+			return	(char *)p ;
+		p += search->skip[c] ;
+	}
+
+	return	NULL ;
+}
+
+/** @fn char *	tb_memstr (const char * mem, size_t mem_len, const char * str)
+    @brief	strstr의 메모리 버전. strstr과 달리 중간에 NULL 문자 있어도 끝까지 탐색함. 같은 문자열을 반복해서 찾는 경우 tb_memsearch 사용
+    @param	mem	문자열 찾을 메모리 주소
+    @param	mem_len	mem의 길이
+    @param	str	찾을 문자열
+    @return	str이 최초로 나온 위치 반환. 없으면 NULL 반환
+*/
+char *	tb_memstr (const char * mem, size_t mem_len, const char * str)
+{
+	MEMSEARCH_T	search ;
+	tb_memsearch_init(&search, str, strlen(str)) ;
+
+	return	tb_memsearch(&search, mem, mem_len) ;
 }
 
 /** @fn const char *	tb_replace_string (apr_pool_t * pool, const char * src, const char * pattern, const char * replace)
@@ -321,6 +535,24 @@ char *	tb_strncopy (char * dest, const char * src, size_t n)
 	return	dest;
 }
 
+/* JSON writer 로 "key":"value" 를 escape 하면서 한 버퍼에 바로 씀. value 가 빈 경우 null 이 1이면 null, 아니면 "" */
+static	char *	key_value_json_quoted (apr_pool_t * pool, const char * key, const char * value, int null)
+{
+	size_t		key_n = strlen(key) ;
+	size_t		value_n = value ? strlen(value) : 0 ;
+	JSON_WRITER_T *	writer = tb_json_writer_make(pool, key_n + value_n + value_n / 8 + 8) ;
+
+	tb_json_writer_key(writer, key) ;
+	if (value_n)
+		tb_json_writer_string_n(writer, value, value_n) ;
+	else if (null)
+		tb_json_writer_null(writer) ;
+	else
+		tb_json_writer_string_n(writer, "", 0) ;
+
+	return	(char *)tb_json_writer_result(writer, NULL) ;
+}
+
 /** @fn char *	tb_key_value_json_string (apr_pool_t * pool, const char * key, const char * value)
     @brief	json key value 형식 문자열 생성
     @param	pool	메모리 할당 풀
@@ -330,7 +562,7 @@ char *	tb_strncopy (char * dest, const char * src, size_t n)
 */
 char *	tb_key_value_json_string (apr_pool_t * pool, const char * key, const char * value)
 {
-	return	apr_psprintf(pool, "\"%s\":%s", key, tb_quoted_string(pool, value, 1)) ;
+	return	key_value_json_quoted(pool, key, value, 1) ;
 }
 
 /** @fn char *	tb_key_value_json_string_not_null (apr_pool_t * pool, const char * key, const char * value)
@@ -342,7 +574,7 @@ char *	tb_key_value_json_string (apr_pool_t * pool, const char * key, const char
 */
 char *	tb_key_value_json_string_not_null (apr_pool_t * pool, const char * key, const char * value)
 {
-	return	apr_psprintf(pool, "\"%s\":%s", key, tb_quoted_string(pool, value, 0)) ;
+	return	key_value_json_quoted(pool, key, value, 0) ;
 }
 
 /** @fn char *	tb_key_value_json_direct (apr_pool_t * pool, const char * key, const char * value)
@@ -357,6 +589,22 @@ char *	tb_key_value_json_direct (apr_pool_t * pool, const char * key, const char
 	return	apr_psprintf(pool, "\"%s\":%s", key, value ? : "null") ;
 }
 
+/* "key":숫자 형식으로 key 를 escape 하면서 한 번에 씀. key 는 짧으므로 escape 최대 길이로 확보함 */
+static	char *	key_value_json_number (apr_pool_t * pool, const char * key, const char * number, size_t number_n)
+{
+	size_t	key_n = strlen(key) ;
+	char *	json = apr_palloc(pool, key_n * 6 + number_n + 4) ;
+	char *	d = json ;
+
+	*d++ = '"' ;
+	d = tb_escape_json_buffer(d, key, key_n) ;
+	*d++ = '"' ;
+	*d++ = ':' ;
+	memcpy(d, number, number_n + 1) ;
+
+	return	json ;
+}
+
 /** @fn char *	tb_key_value_json_integer (apr_pool_t * pool, const char * key, int value)
     @brief	json key value 형식 문자열 생성. value integer
     @param	pool	메모리 할당 풀
@@ -366,7 +614,7 @@ char *	tb_key_value_json_direct (apr_pool_t * pool, const char * key, const char
 */
 char *	tb_key_value_json_integer (apr_pool_t * pool, const char * key, int value)
 {
-	return	apr_psprintf(pool, "\"%s\":%d", key, value) ;
+	return	tb_key_value_json_long(pool, key, value) ;
 }
 
 /** @fn char *	tb_key_value_json_long (apr_pool_t * pool, const char * key, long value)
@@ -378,11 +626,24 @@ char *	tb_key_value_json_integer (apr_pool_t * pool, const char * key, int value
 */
 char *	tb_key_value_json_long (apr_pool_t * pool, const char * key, long value)
 {
-	return	apr_psprintf(pool, "\"%s\":%ld", key, value) ;
+	char	number [TB_NUMBER_BUF_SIZE] ;
+	return	key_value_json_number(pool, key, number, tb_ltoa(number, value) - number) ;
+}
+
+/* tb_key_value_json_float, tb_key_value_json_double 소수점 아래 자릿수. 음수면 가장 짧은 정확한 표현 */
+static	int	json_double_precision = 2 ;
+
+/** @fn void	tb_set_json_double_precision (int precision)
+    @brief	tb_key_value_json_float, tb_key_value_json_double 의 소수점 아래 자릿수 설정. 기본값은 2(%.2f)
+    @param	precision	소수점 아래 자릿수. 0 ~ 17. 음수면 다시 읽었을 때 같은 값이 되는 가장 짧은 문자열로 출력
+*/
+void	tb_set_json_double_precision (int precision)
+{
+	json_double_precision = precision ;
 }
 
 /** @fn char *	tb_key_value_json_float (apr_pool_t * pool, const char * key, float value)
-    @brief	json key value 형식 문자열 생성. value float
+    @brief	json key value 형식 문자열 생성. value float. 자릿수는 tb_set_json_double_precision 설정을 따르고 NaN, Infinity 는 null
     @param	pool	메모리 할당 풀
     @param	key	key
     @param	value	value
@@ -390,11 +651,14 @@ char *	tb_key_value_json_long (apr_pool_t * pool, const char * key, long value)
 */
 char *	tb_key_value_json_float (apr_pool_t * pool, const char * key, float value)
 {
-	return	apr_psprintf(pool, "\"%s\":%.2f", key, value) ;
+	char	number [TB_NUMBER_BUF_SIZE] ;
+	char *	e = json_double_precision < 0 ? tb_ftoa(number, value) : tb_dtoa_fixed(number, value, json_double_precision) ;
+
+	return	key_value_json_number(pool, key, number, e - number) ;
 }
 
 /** @fn char *	tb_key_value_json_double (apr_pool_t * pool, const char * key, double value)
-    @brief	json key value 형식 문자열 생성. value double
+    @brief	json key value 형식 문자열 생성. value double. 자릿수는 tb_set_json_double_precision 설정을 따르고 NaN, Infinity 는 null
     @param	pool	메모리 할당 풀
     @param	key	key
     @param	value	value
@@ -402,7 +666,8 @@ char *	tb_key_value_json_float (apr_pool_t * pool, const char * key, float value
 */
 char *	tb_key_value_json_double (apr_pool_t * pool, const char * key, double value)
 {
-	return	apr_psprintf(pool, "\"%s\":%.2f", key, value) ;
+	char	number [TB_NUMBER_BUF_SIZE] ;
+	return	key_value_json_number(pool, key, number, tb_dtoa_fixed(number, value, json_double_precision) - number) ;
 }
 
 /** @fn char *	tb_key_value_json_boolean (apr_pool_t * pool, const char * key, int value)
@@ -561,11 +826,7 @@ int	tb_table_integer (apr_table_t * t, const char * name, int def)
 	if (! t)
 		return	def ;
 
-	const char *	val = apr_table_get(t, name) ;
-	if (val && isdigit(*val))
-		return	atoi(val) ;
-
-	return	def ;
+	return	tb_atoi(apr_table_get(t, name), def) ;
 }
 
 /** @fn const char *	tb_table_string (apr_table_t * t, const char * name, const char * def)
@@ -587,37 +848,67 @@ const char *	tb_table_string (apr_table_t * t, const char * name, const char * d
 	return	def ;
 }
 
+static	int	table_push_value (void * rec, const char * key, const char * value)
+{
+	APR_ARRAY_PUSH((apr_array_header_t *)rec, const char *) = value ;
+	return	1 ;
+}
+
+/** @fn apr_array_header_t *	tb_table_values (apr_pool_t * pool, apr_table_t * t, const char * name)
+    @brief	table에서 같은 key 의 값을 모두 읽기. apr_table_addn 으로 추가한 여러 값을 합치지 않고 그대로 읽음
+    @param	pool	메모리 할당 풀
+    @param	t	table
+    @param	name	table에서 읽을 key
+    @return	값 목록. const char * array 이며 없으면 빈 array
+*/
+apr_array_header_t *	tb_table_values (apr_pool_t * pool, apr_table_t * t, const char * name)
+{
+	apr_array_header_t *	values = apr_array_make(pool, 4, sizeof(const char *)) ;
+
+	if (t && name)
+		apr_table_do(table_push_value, values, t, name, NULL) ;
+
+	return	values ;
+}
+
 /** @fn int	tb_atoi (const char * src, int def)
-    @brief	atoi wrapping
+    @brief	문자열 앞부분의 숫자를 integer 로 변환. 뒤의 문자는 무시하므로 "123.json" 은 123. 숫자 전체를 검사하려면 tb_parse_int 사용
     @param	src	변환할 문자열
     @param	def	기본값
-    @return	integer value
+    @return	integer value. src 가 NULL 이거나 숫자로 시작하지 않거나 범위를 넘으면 def
 */
 int	tb_atoi (const char * src, int def)
 {
-	return	src ? atoi(src) : def ;
+	long	value ;
+
+	if (!src || tb_parse_long_prefix(src, strlen(src), &value, NULL) != SUCCESS || value < INT_MIN || value > INT_MAX)
+		return	def ;
+
+	return	(int)value ;
 }
 
 /** @fn long	tb_atol (const char * src, long def)
-    @brief	atol wrapping
+    @brief	문자열 앞부분의 숫자를 long 으로 변환. 뒤의 문자는 무시. 숫자 전체를 검사하려면 tb_parse_long 사용
     @param	src	변환할 문자열
     @param	def	기본값
-    @return	long value
+    @return	long value. src 가 NULL 이거나 숫자로 시작하지 않거나 범위를 넘으면 def
 */
 long	tb_atol (const char * src, long def)
 {
-	return	src ? atol(src) : def ;
+	long	value ;
+	return	src && tb_parse_long_prefix(src, strlen(src), &value, NULL) == SUCCESS ? value : def ;
 }
 
 /** @fn double	tb_atof (const char * src, double def)
-    @brief	atof wrapping
+    @brief	문자열 앞부분의 숫자를 double 로 변환. 뒤의 문자는 무시하고 locale 에 영향받지 않음. 숫자 전체를 검사하려면 tb_parse_double 사용
     @param	src	변환할 문자열
     @param	def	기본값
-    @return	double value
+    @return	double value. src 가 NULL 이거나 숫자로 시작하지 않거나 범위를 넘으면 def
 */
 double	tb_atof (const char * src, double def)
 {
-	return	src ? atof(src) : def ;
+	double	value ;
+	return	src && tb_parse_double_prefix(src, strlen(src), &value, NULL) == SUCCESS ? value : def ;
 }
 
 /** @fn time_t	tb_atot (const char * src, time_t def)
@@ -714,6 +1005,255 @@ const char *	tb_table_to_url (apr_pool_t * pool, apr_table_t * t)
 	return	apr_array_pstrcat(pool, a, '&') ;
 }
 
+/** @fn char *	tb_hex_encode (char * dst, const void * src, size_t len)
+    @brief	binary 데이터를 소문자 hex 문자열로 변환
+    @param	dst	출력 버퍼. len * 2 + 1 이상이어야 함
+    @param	src	변환할 데이터
+    @param	len	데이터 길이
+    @return	dst 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_hex_encode (char * dst, const void * src, size_t len)
+{
+	const unsigned char *	p = src ;
+	const unsigned char *	e = p + len ;
+
+	for (; p < e; p++)
+	{
+		*dst++ = hex_digits[*p >> 4] ;
+		*dst++ = hex_digits[*p & 0x0f] ;
+	}
+	*dst = '\0' ;
+
+	return	dst ;
+}
+
+static	const char	base64_digits [] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" ;
+
+/** @fn char *	tb_base64_encode (char * dst, const void * src, size_t len)
+    @brief	binary 데이터를 base64 로 인코딩. 끝에 = padding 붙임
+    @param	dst	출력 버퍼. TB_BASE64_ENCODED_LEN(len) + 1 이상이어야 함
+    @param	src	인코딩할 데이터
+    @param	len	데이터 길이
+    @return	dst 에 쓴 마지막 문자 다음 위치. 그 자리에 NULL 문자가 있음
+*/
+char *	tb_base64_encode (char * dst, const void * src, size_t len)
+{
+	const unsigned char *	p = src ;
+	const unsigned char *	e = p + len - len % 3 ;
+
+	/* 3 byte 씩 4 문자로 */
+	for (; p < e; p += 3)
+	{
+		unsigned int	v = (p[0] << 16) | (p[1] << 8) | p[2] ;
+
+		*dst++ = base64_digits[v >> 18] ;
+		*dst++ = base64_digits[(v >> 12) & 0x3f] ;
+		*dst++ = base64_digits[(v >> 6) & 0x3f] ;
+		*dst++ = base64_digits[v & 0x3f] ;
+	}
+
+	if (len % 3)
+	{
+		unsigned int	v = p[0] << 16 ;
+		if (len % 3 == 2)
+			v |= p[1] << 8 ;
+
+		*dst++ = base64_digits[v >> 18] ;
+		*dst++ = base64_digits[(v >> 12) & 0x3f] ;
+		*dst++ = len % 3 == 2 ? base64_digits[(v >> 6) & 0x3f] : '=' ;
+		*dst++ = '=' ;
+	}
+	*dst = '\0' ;
+
+	return	dst ;
+}
+
+struct	DIGEST_T
+{
+	const EVP_MD *	md ;
+	EVP_MD_CTX *	ctx ;
+} ;
+
+static	const EVP_MD *	digest_md (int type)
+{
+	switch (type)
+	{
+		case DIGEST_MD5 :	return	EVP_md5() ;
+		case DIGEST_SHA1 :	return	EVP_sha1() ;
+		case DIGEST_SHA256 :	return	EVP_sha256() ;
+	}
+
+	return	NULL ;
+}
+
+static	apr_status_t	digest_cleanup (void * data)
+{
+	EVP_MD_CTX_free(((DIGEST_T *)data)->ctx) ;
+	return	APR_SUCCESS ;
+}
+
+/** @fn DIGEST_T *	tb_digest_make (apr_pool_t * pool, int type)
+    @brief	digest 생성. tb_digest_update 로 chunk 단위로 입력하고 tb_digest_final 로 결과를 읽으므로 데이터 전체를 메모리에 올릴 필요 없음
+    @param	pool	메모리 할당 풀. pool 이 정리될 때 context 도 해제됨
+    @param	type	DIGEST_MD5, DIGEST_SHA1, DIGEST_SHA256
+    @return	생성한 digest. 실패시 NULL 반환
+*/
+DIGEST_T *	tb_digest_make (apr_pool_t * pool, int type)
+{
+	const EVP_MD *	md = digest_md(type) ;
+	if (! md)
+		return	NULL ;
+
+	DIGEST_T *	digest = apr_pcalloc(pool, sizeof(DIGEST_T)) ;
+	digest->md = md ;
+	if (! (digest->ctx = EVP_MD_CTX_new()))
+		return	NULL ;
+	apr_pool_cleanup_register(pool, digest, digest_cleanup, apr_pool_cleanup_null) ;
+
+	if (! EVP_DigestInit_ex(digest->ctx, md, NULL))
+		return	NULL ;
+
+	return	digest ;
+}
+
+/** @fn int	tb_digest_reset (DIGEST_T * digest)
+    @brief	digest 를 처음 상태로 되돌림. tb_digest_final 후에 같은 객체로 다른 데이터를 계산할 때 사용
+    @param	digest	digest
+    @return	성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_digest_reset (DIGEST_T * digest)
+{
+	return	EVP_DigestInit_ex(digest->ctx, digest->md, NULL) ? SUCCESS : FAIL ;
+}
+
+/** @fn int	tb_digest_update (DIGEST_T * digest, const void * data, size_t len)
+    @brief	digest 에 데이터 추가
+    @param	digest	digest
+    @param	data	데이터
+    @param	len	데이터 길이
+    @return	성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_digest_update (DIGEST_T * digest, const void * data, size_t len)
+{
+	return	EVP_DigestUpdate(digest->ctx, data, len) ? SUCCESS : FAIL ;
+}
+
+/** @fn int	tb_digest_update_file (DIGEST_T * digest, apr_file_t * file)
+    @brief	파일의 현재 위치부터 끝까지 읽으면서 digest 에 추가. 64KB 씩 읽음
+    @param	digest	digest
+    @param	file	읽을 파일
+    @return	성공시 SUCCESS, 읽기 실패시 FAIL
+*/
+int	tb_digest_update_file (DIGEST_T * digest, apr_file_t * file)
+{
+	char		buf [65536] ;
+	apr_size_t	len ;
+	apr_status_t	rv ;
+
+	do
+	{
+		len = sizeof(buf) ;
+		rv = apr_file_read(file, buf, &len) ;
+		if ((rv != APR_SUCCESS && rv != APR_EOF) || (len && tb_digest_update(digest, buf, len) != SUCCESS))
+			return	FAIL ;
+	} while (rv == APR_SUCCESS) ;
+
+	return	SUCCESS ;
+}
+
+/** @fn int	tb_digest_update_brigade (DIGEST_T * digest, apr_bucket_brigade * bb)
+    @brief	bucket brigade 의 데이터를 digest 에 추가. brigade 를 하나로 합치지 않고 bucket 단위로 읽음. metadata bucket 은 건너뜀
+    @param	digest	digest
+    @param	bb	bucket brigade
+    @return	성공시 SUCCESS, 실패시 FAIL
+*/
+int	tb_digest_update_brigade (DIGEST_T * digest, apr_bucket_brigade * bb)
+{
+	apr_bucket *	b ;
+
+	for (b = APR_BRIGADE_FIRST(bb); b != APR_BRIGADE_SENTINEL(bb); b = APR_BUCKET_NEXT(b))
+	{
+		if (APR_BUCKET_IS_METADATA(b))
+			continue ;
+
+		const char *	data ;
+		apr_size_t	len ;
+		if (apr_bucket_read(b, &data, &len, APR_BLOCK_READ) != APR_SUCCESS || tb_digest_update(digest, data, len) != SUCCESS)
+			return	FAIL ;
+	}
+
+	return	SUCCESS ;
+}
+
+/** @fn unsigned int	tb_digest_final (DIGEST_T * digest, unsigned char * md)
+    @brief	digest 결과 읽기. 이후에 다시 사용하려면 tb_digest_reset 호출해야 함
+    @param	digest	digest
+    @param	md	결과 저장할 버퍼. DIGEST_SIZE_MAX 이상이면 항상 충분함
+    @return	결과 길이. MD5 16, SHA1 20, SHA256 32. 실패시 0
+*/
+unsigned int	tb_digest_final (DIGEST_T * digest, unsigned char * md)
+{
+	unsigned int	md_n = 0 ;
+
+	if (! EVP_DigestFinal_ex(digest->ctx, md, &md_n))
+		return	0 ;
+
+	return	md_n ;
+}
+
+/** @fn const char *	tb_digest_final_hex (apr_pool_t * pool, DIGEST_T * digest)
+    @brief	digest 결과를 hex 문자열로 읽기
+    @param	pool	메모리 할당 풀
+    @param	digest	digest
+    @return	hex 문자열. 실패시 NULL 반환
+*/
+const char *	tb_digest_final_hex (apr_pool_t * pool, DIGEST_T * digest)
+{
+	unsigned char	md [DIGEST_SIZE_MAX] ;
+	unsigned int	md_n = tb_digest_final(digest, md) ;
+	if (! md_n)
+		return	NULL ;
+
+	char *	result = apr_palloc(pool, md_n * 2 + 1) ;
+	tb_hex_encode(result, md, md_n) ;
+
+	return	result ;
+}
+
+/** @fn const char *	tb_digest_final_base64 (apr_pool_t * pool, DIGEST_T * digest)
+    @brief	digest 결과를 base64 문자열로 읽기. Content-MD5 header 등에 사용
+    @param	pool	메모리 할당 풀
+    @param	digest	digest
+    @return	base64 문자열. 실패시 NULL 반환
+*/
+const char *	tb_digest_final_base64 (apr_pool_t * pool, DIGEST_T * digest)
+{
+	unsigned char	md [DIGEST_SIZE_MAX] ;
+	unsigned int	md_n = tb_digest_final(digest, md) ;
+	if (! md_n)
+		return	NULL ;
+
+	char *	result = apr_palloc(pool, TB_BASE64_ENCODED_LEN(md_n) + 1) ;
+	tb_base64_encode(result, md, md_n) ;
+
+	return	result ;
+}
+
+/* 메모리에 있는 데이터 한 번에 digest 계산해서 hex 문자열로 */
+static	const char *	digest_hex (apr_pool_t * pool, int type, const void * data, size_t len)
+{
+	unsigned char	md [DIGEST_SIZE_MAX] ;
+	unsigned int	md_n ;
+
+	if (! EVP_Digest(data, len, md, &md_n, digest_md(type), NULL))
+		return	NULL ;
+
+	char *	result = apr_palloc(pool, md_n * 2 + 1) ;
+	tb_hex_encode(result, md, md_n) ;
+
+	return	result ;
+}
+
 /** @fn const char *	tb_sha256_hash (apr_pool_t * pool, const char * str)
     @brief	sha256 hash 문자열 생성
     @param	pool	메모리 할당 풀
@@ -722,18 +1262,7 @@ const char *	tb_table_to_url (apr_pool_t * pool, apr_table_t * t)
 */
 const char *	tb_sha256_hash (apr_pool_t * pool, const char * str)
 {
-	unsigned char	hash[SHA256_DIGEST_LENGTH] ;
-	SHA256_CTX	sha256 ;
-	SHA256_Init(&sha256) ;
-	SHA256_Update(&sha256, str, strlen(str)) ;
-	SHA256_Final(hash, &sha256) ;
-
-	int	i = 0 ;
-	char *	result = apr_pcalloc(pool, SHA256_DIGEST_LENGTH * 2 + 1) ;
-	for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
-		sprintf(&result[i * 2], "%02x", hash[i]) ;
-
-	return	result ;
+	return	digest_hex(pool, DIGEST_SHA256, str, strlen(str)) ;
 }
 
 /** @fn const char *	tb_sha1_hash_raw (apr_pool_t * pool, const char * str, size_t str_len)
@@ -745,18 +1274,7 @@ const char *	tb_sha256_hash (apr_pool_t * pool, const char * str)
 */
 const char *	tb_sha1_hash_raw (apr_pool_t * pool, const char * str, size_t str_len)
 {
-	unsigned char	hash[SHA_DIGEST_LENGTH] ;
-	SHA_CTX	sha1 ;
-	SHA1_Init(&sha1) ;
-	SHA1_Update(&sha1, str, str_len) ;
-	SHA1_Final(hash, &sha1) ;
-
-	int	i = 0 ;
-	char *	result = apr_pcalloc(pool, SHA_DIGEST_LENGTH * 2 + 1) ;
-	for (i = 0; i < SHA_DIGEST_LENGTH; i++)
-		sprintf(&result[i * 2], "%02x", hash[i]) ;
-
-	return	result ;
+	return	digest_hex(pool, DIGEST_SHA1, str, str_len) ;
 }
 
 /** @fn const char *	tb_sha1_hash (apr_pool_t * pool, const char * str)
@@ -779,18 +1297,7 @@ const char *	tb_sha1_hash (apr_pool_t * pool, const char * str)
 */
 const char *	tb_md5_hash_raw (apr_pool_t * pool, const char * str, size_t str_len)
 {
-	unsigned char	hash[MD5_DIGEST_LENGTH] ;
-	MD5_CTX		ctx ;
-	MD5_Init(&ctx) ;
-	MD5_Update(&ctx, str, str_len) ;
-	MD5_Final(hash, &ctx) ;
-
-	int	i = 0 ;
-	char *	result = apr_pcalloc(pool, MD5_DIGEST_LENGTH * 2 + 1) ;
-	for (i = 0; i < MD5_DIGEST_LENGTH; i++)
-		sprintf(&result[i * 2], "%02x", hash[i]) ;
-
-	return	result ;
+	return	digest_hex(pool, DIGEST_MD5, str, str_len) ;
 }
 
 /** @fn const char *	tb_md5_hash (apr_pool_t * pool, const char * str)
@@ -829,10 +1336,8 @@ const void *	tb_hmac_hash (apr_pool_t * pool, const void * key, int key_len, con
 		if (binary)
 			return	result ;
 
-		int	i;
-		char *	md_string = apr_pcalloc(pool, result_len * 2 + 1) ;
-		for (i = 0; i < result_len; i++)
-			sprintf(&md_string[i * 2], "%02x", (unsigned int)result[i]) ;
+		char *	md_string = apr_palloc(pool, result_len * 2 + 1) ;
+		tb_hex_encode(md_string, result, result_len) ;
 
 		return	md_string ;
 	}